@@ -285,16 +285,24 @@ void construct_node_maps(struct All_variables *E)
 	int nn, lev, i, j, k, ja, jj, ii, kk, ia, is, ie, js, je, ks, ke;
 	//int doff, nox, noy, noz, noxz, node1, eqn1, loc1, count, found, element;
 	int doff, nox, noy, noz, noxz;
-	int neq, nno, matrix;
+	int neq, nno, nel, matrix;
+	int e, a, b, node, node1, loc0;
+	signed char *slot;
 	//int *node_map;
 
 	const int dims = E->mesh.nsd;
 	//const int dofs = E->mesh.dof;
-	//const int ends = enodes[dims];
+	const int ends = enodes[dims];
 	const int max_eqn = max_eqn_interaction[dims];
 
 	for(lev = E->mesh.levmax; lev >= E->mesh.levmin; lev--)
 	{
+		if(E->control.matrix_free && lev == E->mesh.levmax)
+		{						/* K is applied element by element */
+			E->mesh.matrix_size[lev] = 0;
+			continue;
+		}
+
 		neq = E->lmesh.NEQ[lev];
 		nno = E->lmesh.NNO[lev];
 		nox = E->lmesh.NOX[lev];
@@ -345,9 +353,39 @@ void construct_node_maps(struct All_variables *E)
 		  E->Eqn_k2[lev] = (higher_precision *) malloc((matrix + 5) * sizeof(higher_precision));
 		  if(dims == 3)
 		    E->Eqn_k3[lev] = (higher_precision *) malloc((matrix + 5) * sizeof(higher_precision));
+		  E->Elt_slot[lev] = (signed char *)safe_malloc((E->lmesh.NEL[lev] * ends * ends + 1) * sizeof(signed char));
 
 		}
 
+		/* where the (node a, node b) block of an element matrix lands
+		 * in node a's Eqn_k row, so that assembly needs no search. The
+		 * equations of a node are consecutive, so one offset serves all
+		 * dims directions: one byte per node pair, ends*ends per element */
+		nel = E->lmesh.NEL[lev];
+		for(e = 1; e <= nel; e++)
+			for(a = 1; a <= ends; a++)
+			{
+				node = E->IEN[lev][e].node[a];
+				loc0 = (node - 1) * max_eqn;
+				for(b = 1; b <= ends; b++)
+				{
+					node1 = E->IEN[lev][e].node[b];
+					slot = E->Elt_slot[lev] + ((e - 1) * ends + a - 1) * ends + b - 1;
+					*slot = -1;
+					if(node1 > node)
+						continue;
+					for(k = 0; k <= max_eqn - dims; k++)
+						if(E->Node_map[lev][loc0 + k] == E->LMD[lev][e].node[b].doff[1])
+						{
+							*slot = k;
+							break;
+						}
+					assert(*slot >= 0);
+					for(doff = 2; doff <= dims; doff++)
+						assert(E->Node_map[lev][loc0 + k + doff - 1] == E->LMD[lev][e].node[b].doff[doff]);
+				}
+			}
+
 		E->mesh.matrix_size[lev] = matrix + 1;
 	}							/* end for level and m */
 
@@ -359,13 +397,12 @@ void construct_node_maps(struct All_variables *E)
 void construct_node_ks(struct All_variables *E)
 {
 	//int lev, level, i, j, k, e;
-	int level, i, j, k;
+	int level, i, j;
 	//int node, node1, eqn1, eqn2, eqn3, loc0, loc1, loc2, loc3, found, element, index, pp, qq;
-	int node, node1, eqn1, eqn2, eqn3, loc0, found, element, index, pp, qq;
+	int loc0, element, e0, e1, threaded;
 	int neq, nno, nel;
 
-	double elt_K[24 * 24];
-	double w1, w2, w3, ww1, ww2, ww3;
+	static double *elt_Ks;
 
 	//higher_precision *B1, *B2, *B3;
 	higher_precision *B1, *B2;
@@ -373,13 +410,34 @@ void construct_node_ks(struct All_variables *E)
 
 	const int dims = E->mesh.nsd;
 	//const int dofs = E->mesh.dof;
-	const int ends = enodes[dims];
-	const int lms = loc_mat_size[E->mesh.nsd];
 	const int max_eqn = max_eqn_interaction[dims];
-	//const int vpts = vpoints[E->mesh.nsd];
+	const int vpts = vpoints[E->mesh.nsd];
+	const int lms = loc_mat_size[E->mesh.nsd];
+	const int chunk = 128;		/* element matrices computed per threaded pass */
 
 	const double zero = 0.0;
 
+	static int been_here = 0;
+
+	if(been_here == 0)
+	{
+		elt_Ks = (double *)safe_malloc(chunk * lms * lms * sizeof(double));
+		if(E->control.stiffness_update_tol > 0.0)
+			for(level = E->mesh.levmin; level <= E->mesh.levmax; level++)
+			{
+				E->BD[level] = (double *)safe_malloc((E->lmesh.NEQ[level] + 2) * sizeof(double));
+				E->EVI_K[level] = (float *)safe_malloc((E->lmesh.NEL[level] * vpts + 1) * sizeof(float));
+			}
+	}
+	been_here = 1;
+
+	/* get_elt_k keeps static state between elements for the
+	 * spherical and anisotropic cases, only cartesian is threaded */
+	threaded = E->control.CART3D;
+#ifdef CITCOM_ALLOW_ANISOTROPIC_VISC
+	if(E->viscosity.allow_anisotropic_viscosity)
+		threaded = 0;
+#endif
 
 	for(level = E->mesh.levmax; level >= E->mesh.levmin; level--)
 	{
@@ -389,152 +447,926 @@ void construct_node_ks(struct All_variables *E)
 
 		for(i = 0; i <= (neq + 1); i++)
 			E->BI[level][i] = zero;
-		for(i = 0; i <= E->mesh.matrix_size[level]; i++)
+		if(E->mesh.matrix_size[level])
+			for(i = 0; i <= E->mesh.matrix_size[level]; i++)
+			{
+				E->Eqn_k1[level][i] = zero;
+				E->Eqn_k2[level][i] = zero;
+				E->Eqn_k3[level][i] = zero;
+			}
+
+		/* the element matrices are independent and can be computed
+		 * by threads, the scatter stays in element order so the
+		 * result does not depend on the thread count */
+		for(e0 = 1; e0 <= nel; e0 += chunk)
 		{
-			E->Eqn_k1[level][i] = zero;
-			E->Eqn_k2[level][i] = zero;
-			E->Eqn_k3[level][i] = zero;
+			e1 = min(e0 + chunk - 1, nel);
+
+#pragma omp parallel for schedule(static) if(threaded)
+			for(element = e0; element <= e1; element++)
+			{
+				get_elt_k(E, element, elt_Ks + (element - e0) * lms * lms, level, 0);
+
+				if(E->control.augmented_Lagr)
+					get_aug_k(E, element, elt_Ks + (element - e0) * lms * lms, level);
+			}
+
+			for(element = e0; element <= e1; element++)
+			{
+				build_diagonal_of_K(E, element, elt_Ks + (element - e0) * lms * lms, level);
+
+				if(E->control.matrix_free && level == E->mesh.levmax)
+					continue;	/* only the diagonal is kept */
+
+				add_elt_k_to_node_ks(E, element, elt_Ks + (element - e0) * lms * lms, level, 1.0);
+			}
+		}						/* element */
+
+
+		if(E->control.stiffness_update_tol > 0.0)
+		{
+			/* what incremental updates start from */
+			for(j = 0; j < neq; j++)
+				E->BD[level][j] = E->BI[level][j];
+			for(j = 1; j <= nel * vpts; j++)
+				E->EVI_K[level][j] = E->EVI[level][j];
+		}
+
+		exchange_id_d20(E, E->BI[level], level);
+
+
+		for(j = 0; j < neq; j++)
+		{
+			if(E->BI[level][j] == 0.0)
+				fprintf(stderr, "me= %d level %d, equation %d/%d has zero diagonal term\n", E->parallel.me, level, j, neq);
+			assert(E->BI[level][j] != 0 /* diagonal of matrix = 0, not acceptable */ );
+			E->BI[level][j] = (float)1.0 / E->BI[level][j];
 		}
 
-		for(element = 1; element <= nel; element++)
+		E->control.B_is_good[level] = 0;
+
+		if(E->control.verbose && E->mesh.matrix_size[level])
 		{
+			fprintf(stderr, "output stiffness matrix!!!\n");
+			fprintf(E->fp, "level %d\n", level);
+			for(j = 1; j <= nno; j++)
+			{
+				loc0 = (j - 1) * max_eqn;
+				B1 = E->Eqn_k1[level] + loc0;
+				B2 = E->Eqn_k2[level] + loc0;
+				for(i = 0; i < max_eqn; i++)
+				{
+					fprintf(E->fp, "%d %d %g %g\n", j, i, B1[i], B2[i]);
+				}
+			}
+		}
 
-			get_elt_k(E, element, elt_K, level, 0);
+	} /* level loop */
 
-			if(E->control.augmented_Lagr)
-				get_aug_k(E, element, elt_K, level);
+	return;
+}
 
-			build_diagonal_of_K(E, element, elt_K, level);
 
-			for(i = 1; i <= ends; i++)
-			{					/* i, is the node we are storing to */
-				node = E->IEN[level][element].node[i];
 
-				pp = (i - 1) * dims;
-				w1 = w2 = w3 = 1.0;
+/* adds scale * elt_K of the element into the node storage
+ * (Eqn_k1,2,3 at the Elt_slot offsets), with velocity boundary
+ * conditions removed */
 
-				loc0 = (node - 1) * max_eqn;
+void add_elt_k_to_node_ks(struct All_variables *E, int element, double elt_K[24 * 24], int level, double scale)
+{
+	int i, j, k, node, node1, pp, qq, loc;
+	signed char slot;
+	double w1, w2, w3, ww;
 
-				if(E->NODE[level][node] & VBX)
-					w1 = 0.0;
-				if(E->NODE[level][node] & VBY)
-					w2 = 0.0;
-				if(E->NODE[level][node] & VBZ)
-					w3 = 0.0;
-
-				for(j = 1; j <= ends; j++)
-				{				/* j is the node we are receiving from */
-					node1 = E->IEN[level][element].node[j];
-					if(node1 <= node)
-					{
-						ww1 = ww2 = ww3 = 1.0;
-						qq = (j - 1) * dims;
-						eqn1 = E->LMD[level][element].node[j].doff[1];
-						eqn2 = E->LMD[level][element].node[j].doff[2];
-						eqn3 = E->LMD[level][element].node[j].doff[3];
-
-						if(E->NODE[level][node1] & VBX)
-							ww1 = 0.0;
-						if(E->NODE[level][node1] & VBY)
-							ww2 = 0.0;
-						if(E->NODE[level][node1] & VBZ)
-							ww3 = 0.0;
-
-						/* search for direction 1 */
-
-						found = 0;
-						for(k = 0; k < max_eqn; k++)
-							if(E->Node_map[level][loc0 + k] == eqn1)
-							{	/* found, index next equation */
-								index = k;
-								found++;
-								break;
-							}
+	const int dims = E->mesh.nsd;
+	const int ends = enodes[dims];
+	const int lms = loc_mat_size[E->mesh.nsd];
+	const int max_eqn = max_eqn_interaction[dims];
 
-						assert(found /* direction 1 */ );
+	for(i = 1; i <= ends; i++)
+	{					/* i, is the node we are storing to */
+		node = E->IEN[level][element].node[i];
 
-						E->Eqn_k1[level][loc0 + index] += w1 * ww1 * elt_K[pp * lms + qq];	/* direction 1 */
-						E->Eqn_k2[level][loc0 + index] += w2 * ww1 * elt_K[(pp + 1) * lms + qq];	/* direction 1 */
-						E->Eqn_k3[level][loc0 + index] += w3 * ww1 * elt_K[(pp + 2) * lms + qq];	/* direction 1 */
+		pp = (i - 1) * dims;
+		w1 = w2 = w3 = scale;
 
-						/* search for direction 2 */
+		if(E->NODE[level][node] & VBX)
+			w1 = 0.0;
+		if(E->NODE[level][node] & VBY)
+			w2 = 0.0;
+		if(E->NODE[level][node] & VBZ)
+			w3 = 0.0;
 
-						found = 0;
-						for(k = 0; k < max_eqn; k++)
-							if(E->Node_map[level][loc0 + k] == eqn2)
-							{	/* found, index next equation */
-								index = k;
-								found++;
-								break;
-							}
+		for(j = 1; j <= ends; j++)
+		{				/* j is the node we are receiving from */
+			slot = E->Elt_slot[level][((element - 1) * ends + i - 1) * ends + j - 1];
+			if(slot < 0)
+				continue;	/* node1 > node, stored with the other node */
 
-						assert(found /* direction 2 */ );
+			qq = (j - 1) * dims;
+			node1 = E->IEN[level][element].node[j];
+			loc = (node - 1) * max_eqn + slot;
 
-						E->Eqn_k1[level][loc0 + index] += w1 * ww2 * elt_K[pp * lms + qq + 1];	/* direction 1 */
-						E->Eqn_k2[level][loc0 + index] += w2 * ww2 * elt_K[(pp + 1) * lms + qq + 1];	/* direction 2 */
-						E->Eqn_k3[level][loc0 + index] += w3 * ww2 * elt_K[(pp + 2) * lms + qq + 1];	/* direction 3 */
+			for(k = 0; k < dims; k++)
+			{
+				ww = (E->NODE[level][node1] & (k == 0 ? VBX : (k == 1 ? VBY : VBZ))) ? 0.0 : 1.0;
 
-						/* search for direction 3 */
+				E->Eqn_k1[level][loc + k] += w1 * ww * elt_K[pp * lms + qq + k];
+				E->Eqn_k2[level][loc + k] += w2 * ww * elt_K[(pp + 1) * lms + qq + k];
+				E->Eqn_k3[level][loc + k] += w3 * ww * elt_K[(pp + 2) * lms + qq + k];
+			}
+		}
+	}
+
+	return;
+}
 
-						found = 0;
-						for(k = 0; k < max_eqn; k++)
-							if(E->Node_map[level][loc0 + k] == eqn3)
-							{	/* found, index next equation */
-								index = k;
-								found++;
-								break;
-							}
 
+/* ==========================================================
+   Incremental version of construct_node_ks. Only elements in
+   which the viscosity at some integration point has moved by
+   more than stiffness_update_tol (relative) since they were
+   last assembled are taken out of the node storage with the
+   old viscosity (EVI_K) and put back with the new one. The
+   unexchanged diagonal is kept in BD so BI can be rebuilt,
+   and BPI/BPM are only recomputed for elements that touch an
+   equation whose diagonal moved. Returns 0, having changed
+   nothing, when too many elements changed for this to pay.
+   ========================================================== */
+
+int update_node_ks(struct All_variables *E)
+{
+	static int been_here = 0;
+	static char *changed[MAX_LEVELS];
+	static double *flag;
+	double *fields[2];
+	int level, e, i, j, a, d;
+	int neq, nel, npno;
+	double elt_K[24 * 24], count[2], BU;
+	double *BI;
+	float *EVI;
 
-						assert(found /* direction 3 */ );
+	const int dims = E->mesh.nsd;
+	const int ends = enodes[dims];
+	const int lms = loc_mat_size[dims];
+	const int vpts = vpoints[dims];
+	const float tol = E->control.stiffness_update_tol;
 
-						E->Eqn_k1[level][loc0 + index] += w1 * ww3 * elt_K[pp * lms + qq + 2];	/* direction 1 */
-						E->Eqn_k2[level][loc0 + index] += w2 * ww3 * elt_K[(pp + 1) * lms + qq + 2];	/* direction 2 */
-						E->Eqn_k3[level][loc0 + index] += w3 * ww3 * elt_K[(pp + 2) * lms + qq + 2];	/* direction 3 */
+	if(been_here == 0)
+	{
+		for(level = E->mesh.levmin; level <= E->mesh.levmax; level++)
+			changed[level] = (char *)safe_malloc((E->lmesh.NEL[level] + 1) * sizeof(char));
+		flag = (double *)safe_malloc((E->lmesh.NEQ[E->mesh.levmax] + 2) * sizeof(double));
+		been_here = 1;
+	}
 
-					}			/* for node1< node */
+	count[0] = count[1] = 0.0;
+	for(level = E->mesh.levmin; level <= E->mesh.levmax; level++)
+	{
+		nel = E->lmesh.NEL[level];
+		for(e = 1; e <= nel; e++)
+		{
+			changed[level][e] = 0;
+			for(j = (e - 1) * vpts + 1; j <= e * vpts; j++)
+				if(fabs(E->EVI[level][j] - E->EVI_K[level][j]) > tol * E->EVI_K[level][j])
+				{
+					changed[level][e] = 1;
+					count[0] += 1.0;
+					break;
 				}
-			}
-		}						/* element */
+		}
+		count[1] += nel;
+	}
 
+	global_sums(E, count, 2);
 
-		exchange_id_d20(E, E->BI[level], level);
+	/* past about half the elements a clean assembly is cheaper */
+	if(count[0] > 0.5 * count[1])
+		return 0;
+
+	for(level = E->mesh.levmax; level >= E->mesh.levmin; level--)
+	{
+		neq = E->lmesh.NEQ[level];
+		nel = E->lmesh.NEL[level];
+		npno = E->lmesh.NPNO[level];
+
+		for(i = 0; i <= neq + 1; i++)
+			flag[i] = 0.0;
+
+		/* build_diagonal_of_K accumulates into BI, point it at BD */
+		BI = E->BI[level];
+		E->BI[level] = E->BD[level];
+
+		for(e = 1; e <= nel; e++)
+		{
+			if(!changed[level][e])
+				continue;
+
+			/* remove what was assembled with the old viscosity */
+			EVI = E->EVI[level];
+			E->EVI[level] = E->EVI_K[level];
+			get_elt_k(E, e, elt_K, level, 0);
+			if(E->control.augmented_Lagr)
+				get_aug_k(E, e, elt_K, level);
+			E->EVI[level] = EVI;
+
+			for(i = 0; i < lms * lms; i++)
+				elt_K[i] = -elt_K[i];
+
+			build_diagonal_of_K(E, e, elt_K, level);
+			if(!(E->control.matrix_free && level == E->mesh.levmax))
+				add_elt_k_to_node_ks(E, e, elt_K, level, 1.0);
+
+			/* and put it back with the new one */
+			get_elt_k(E, e, elt_K, level, 0);
+			if(E->control.augmented_Lagr)
+				get_aug_k(E, e, elt_K, level);
+
+			build_diagonal_of_K(E, e, elt_K, level);
+			if(!(E->control.matrix_free && level == E->mesh.levmax))
+				add_elt_k_to_node_ks(E, e, elt_K, level, 1.0);
 
+			for(j = (e - 1) * vpts + 1; j <= e * vpts; j++)
+				E->EVI_K[level][j] = E->EVI[level][j];
+
+			for(a = 1; a <= ends; a++)
+				for(d = 1; d <= dims; d++)
+					flag[E->LMD[level][e].node[a].doff[d]] = 1.0;
+		}
+
+		E->BI[level] = BI;
+
+		for(j = 0; j < neq; j++)
+			E->BI[level][j] = E->BD[level][j];
+
+		fields[0] = E->BI[level];
+		fields[1] = flag;
+		exchange_id_d20_fields(E, fields, 2, level);
 
 		for(j = 0; j < neq; j++)
 		{
-			if(E->BI[level][j] == 0.0)
-				fprintf(stderr, "me= %d level %d, equation %d/%d has zero diagonal term\n", E->parallel.me, level, j, neq);
 			assert(E->BI[level][j] != 0 /* diagonal of matrix = 0, not acceptable */ );
 			E->BI[level][j] = (float)1.0 / E->BI[level][j];
 		}
 
 		E->control.B_is_good[level] = 0;
 
-		if(E->control.verbose)
+		/* as build_diagonal_of_Ahat, for the elements that moved */
+		for(e = 1; e <= npno; e++)
 		{
-			fprintf(stderr, "output stiffness matrix!!!\n");
-			fprintf(E->fp, "level %d\n", level);
-			for(j = 1; j <= nno; j++)
+			for(a = 1; a <= ends; a++)
 			{
-				eqn1 = E->ID[level][j].doff[1];
-				eqn2 = E->ID[level][j].doff[2];
-				loc0 = (j - 1) * max_eqn;
-				B1 = E->Eqn_k1[level] + loc0;
-				B2 = E->Eqn_k2[level] + loc0;
-				for(i = 0; i < max_eqn; i++)
+				for(d = 1; d <= dims; d++)
+					if(flag[E->LMD[level][e].node[a].doff[d]] != 0.0)
+						break;
+				if(d <= dims)
+					break;
+			}
+			if(a > ends)
+				continue;
+
+			E->BPM[level][e] = visc_mass_entry(E, e, level);
+
+			if(E->control.precondition)
+			{
+				BU = assemble_dAhatp_entry(E, e, level);
+				E->BPI[level][e] = (BU != 0.0) ? 1.0 / BU : 1.0;
+			}
+		}
+	}
+
+	return 1;
+}
+
+
+/* ==========================================================
+   Unfold the half-symmetric node storage (Node_map/Eqn_k*)
+   into full rows, so that each equation can gather Au from
+   its own row without scattering into its neighbours. This
+   is what allows n_assemble_del2_u to run over threads.
+   Row layout per node: the max_eqn entries of Node_map
+   (self + lower neighbours) followed by the upper neighbours.
+   ========================================================== */
+
+void construct_node_rows(struct All_variables *E)
+{
+	static int been_here = 0;
+	int level, i, d, node, node1;
+	int neq, nno, loc0, loc1;
+	int *C, *R, *fill, *eqn_node;
+	higher_precision *B[3];
+
+	const int dims = E->mesh.nsd;
+	const int max_eqn = max_eqn_interaction[dims];
+	const int max_row = 2 * max_eqn - dims;
+
+	for(level = E->mesh.levmax; level >= E->mesh.levmin; level--)
+	{
+		if(E->control.matrix_free && level == E->mesh.levmax)
+			continue;
+
+		neq = E->lmesh.NEQ[level];
+		nno = E->lmesh.NNO[level];
+
+		if(!been_here)
+		{
+			E->Row_map[level] = (int *)malloc((nno + 1) * max_row * sizeof(int));
+			E->Row_k1[level] = (higher_precision *) malloc((nno + 1) * max_row * sizeof(higher_precision));
+			E->Row_k2[level] = (higher_precision *) malloc((nno + 1) * max_row * sizeof(higher_precision));
+			E->Row_k3[level] = (higher_precision *) malloc((nno + 1) * max_row * sizeof(higher_precision));
+		}
+
+		fill = (int *)malloc((nno + 1) * sizeof(int));
+		eqn_node = (int *)malloc((neq + 2) * sizeof(int));
+
+		for(node = 1; node <= nno; node++)
+			for(d = 1; d <= dims; d++)
+				eqn_node[E->ID[level][node].doff[d]] = node;
+		eqn_node[neq] = eqn_node[neq + 1] = 0;
+
+		B[0] = E->Eqn_k1[level];
+		B[1] = E->Eqn_k2[level];
+		B[2] = E->Eqn_k3[level];
+
+		/* own half: copied as is */
+		for(node = 1; node <= nno; node++)
+		{
+			loc0 = (node - 1) * max_eqn;
+			loc1 = (node - 1) * max_row;
+			for(i = 0; i < max_eqn; i++)
+			{
+				E->Row_map[level][loc1 + i] = E->Node_map[level][loc0 + i];
+				E->Row_k1[level][loc1 + i] = E->Eqn_k1[level][loc0 + i];
+				E->Row_k2[level][loc1 + i] = E->Eqn_k2[level][loc0 + i];
+				E->Row_k3[level][loc1 + i] = E->Eqn_k3[level][loc0 + i];
+			}
+			for(i = max_eqn; i < max_row; i++)
+			{
+				E->Row_map[level][loc1 + i] = neq + 1;
+				E->Row_k1[level][loc1 + i] = E->Row_k2[level][loc1 + i] = E->Row_k3[level][loc1 + i] = 0.0;
+			}
+			fill[node] = max_eqn;
+		}
+
+		/* other half: node1 > node stores K(node1,node), which by
+		 * symmetry is the transpose of the block needed by node */
+		for(node1 = 1; node1 <= nno; node1++)
+		{
+			loc0 = (node1 - 1) * max_eqn;
+			C = E->Node_map[level] + loc0;
+			for(i = dims; i < max_eqn; i += dims)
+			{
+				if(C[i] >= neq)
+					continue;
+				node = eqn_node[C[i]];
+				loc1 = (node - 1) * max_row + fill[node];
+				R = E->Row_map[level] + loc1;
+				for(d = 0; d < dims; d++)
 				{
-					fprintf(E->fp, "%d %d %g %g\n", j, i, B1[i], B2[i]);
+					R[d] = C[d];
+					E->Row_k1[level][loc1 + d] = B[d][loc0 + i];
+					E->Row_k2[level][loc1 + d] = B[d][loc0 + i + 1];
+					E->Row_k3[level][loc1 + d] = B[d][loc0 + i + 2];
 				}
+				fill[node] += dims;
 			}
 		}
 
-	} /* level loop */
+		free((void *)fill);
+		free((void *)eqn_node);
+	}
+
+	been_here = 1;
+	return;
+}
+
+
+/* ==========================================================
+   Copy the node matrix into 3x3 blocks (block_storage=on).
+   Blocks follow the Node_map order (self, then the lower
+   neighbours), with one index per neighbour node: the first
+   equation of that node. Missing neighbours point at the node
+   itself with a zero block. Block k of node n holds
+   K(eqn_r(n), eqn_c(m)) at [9k + 3r + c].
+   ========================================================== */
+
+void construct_node_blocks(struct All_variables *E)
+{
+	static int been_here = 0;
+	int level, node, k, r, c, loc0, neq, nno;
+	int *C;
+	higher_precision *B[3], *K;
+
+	const int dims = E->mesh.nsd;
+	const int max_eqn = max_eqn_interaction[dims];
+	const int max_blk = max_eqn / dims;
+
+	for(level = E->mesh.levmax; level >= E->mesh.levmin; level--)
+	{
+		if(E->control.matrix_free && level == E->mesh.levmax)
+			continue;
 
+		neq = E->lmesh.NEQ[level];
+		nno = E->lmesh.NNO[level];
+
+		if(!been_here)
+		{
+			E->Blk_map[level] = (int *)malloc((nno + 1) * max_blk * sizeof(int));
+			E->Blk_k[level] = (higher_precision *) malloc((nno + 1) * max_blk * dims * dims * sizeof(higher_precision));
+		}
+
+		B[0] = E->Eqn_k1[level];
+		B[1] = E->Eqn_k2[level];
+		B[2] = E->Eqn_k3[level];
+
+		for(node = 1; node <= nno; node++)
+		{
+			loc0 = (node - 1) * max_eqn;
+			C = E->Node_map[level] + loc0;
+			for(k = 0; k < max_blk; k++)
+			{
+				K = E->Blk_k[level] + ((node - 1) * max_blk + k) * dims * dims;
+				if(C[k * dims] >= neq)
+				{
+					E->Blk_map[level][(node - 1) * max_blk + k] = E->ID[level][node].doff[1];
+					for(r = 0; r < dims * dims; r++)
+						K[r] = 0.0;
+					continue;
+				}
+				E->Blk_map[level][(node - 1) * max_blk + k] = C[k * dims];
+				for(r = 0; r < dims; r++)
+					for(c = 0; c < dims; c++)
+						K[r * dims + c] = B[r][loc0 + k * dims + c];
+			}
+		}
+	}
+
+	been_here = 1;
+	return;
+}
+
+
+/* ==========================================================
+   Structured form of the node blocks (stencil_storage=on).
+   Every node keeps the full 14 block stencil (self and its
+   13 lower neighbours in the (y,x,z) order construct_node_maps
+   visits them), zero where the neighbour is off the mesh, so
+   the neighbour equations follow from the node numbering
+   (eqn = dims * (node - 1) + d - 1) and no map is stored.
+   ========================================================== */
+
+void node_stencil_offsets(struct All_variables *E, int level, int off[14])
+{
+	int i, j, k, s;
+
+	const int noz = E->lmesh.NOZ[level];
+	const int noxz = E->lmesh.NOX[level] * noz;
+
+	off[0] = 0;
+	s = 1;
+	for(i = 1; i <= 2; i++)
+		for(j = 1; j <= 3; j++)
+			for(k = 1; k <= 3; k++)
+				if(i == 1 || j == 1 || (j == 2 && k == 1))
+					off[s++] = (2 - i) * noxz + (2 - j) * noz + 2 - k;
+
+	return;
+}
+
+void construct_node_stencils(struct All_variables *E)
+{
+	static int been_here = 0;
+	int level, nn, ii, jj, kk, i, j, k, s, ia, r, c;
+	int is, js, je, ks, ke, nox, noy, noz, nno, loc0;
+	higher_precision *B[3], *K;
+
+	const int dims = E->mesh.nsd;
+	const int max_eqn = max_eqn_interaction[dims];
+	const int max_blk = max_eqn / dims;
+
+	for(level = E->mesh.levmax; level >= E->mesh.levmin; level--)
+	{
+		if(E->control.matrix_free && level == E->mesh.levmax)
+			continue;
+
+		nno = E->lmesh.NNO[level];
+		nox = E->lmesh.NOX[level];
+		noy = E->lmesh.NOY[level];
+		noz = E->lmesh.NOZ[level];
+
+		if(!been_here)
+			E->Stn_k[level] = (higher_precision *) malloc((nno + 1) * max_blk * dims * dims * sizeof(higher_precision));
+
+		for(i = 0; i < nno * max_blk * dims * dims; i++)
+			E->Stn_k[level][i] = 0.0;
+
+		B[0] = E->Eqn_k1[level];
+		B[1] = E->Eqn_k2[level];
+		B[2] = E->Eqn_k3[level];
+
+		for(ii = 1; ii <= noy; ii++)
+			for(jj = 1; jj <= nox; jj++)
+				for(kk = 1; kk <= noz; kk++)
+				{
+					nn = kk + (jj - 1) * noz + (ii - 1) * noz * nox;
+					loc0 = (nn - 1) * max_eqn;
+
+					/* the same walk as construct_node_maps: ia counts
+					 * the Node_map blocks, s the stencil slots */
+					is = (ii == 1) ? 2 : 1;
+					js = (jj == 1) ? 2 : 1;
+					je = (jj == nox) ? 2 : 3;
+					ks = (kk == 1) ? 2 : 1;
+					ke = (kk == noz) ? 2 : 3;
+
+					K = E->Stn_k[level] + (nn - 1) * max_blk * dims * dims;
+					for(r = 0; r < dims; r++)
+						for(c = 0; c < dims; c++)
+							K[r * dims + c] = B[r][loc0 + c];
+
+					ia = s = 0;
+					for(i = 1; i <= 2; i++)
+						for(j = 1; j <= 3; j++)
+							for(k = 1; k <= 3; k++)
+							{
+								if(!(i == 1 || j == 1 || (j == 2 && k == 1)))
+									continue;	/* not a lower neighbour */
+								s++;
+								if(i < is || j < js || j > je || k < ks || k > ke)
+									continue;	/* off the mesh, zero block */
+								ia++;
+								for(r = 0; r < dims; r++)
+									for(c = 0; c < dims; c++)
+										K[s * dims * dims + r * dims + c] = B[r][loc0 + ia * dims + c];
+							}
+				}
+	}
+
+	been_here = 1;
+	return;
+}
+
+
+/* ==========================================================
+   Block tridiagonal factors for the z-line smoother
+   (zline_levels > 0). The nodes of a vertical column are
+   consecutive, so K restricted to a column couples each node
+   only to node-1 and node+1. Per node we keep the inverse of
+   the eliminated diagonal block, the block K(node,node-1) and
+   the inverse times K(node,node+1), 27 doubles. OFFSIDE nodes
+   are not part of any line: they cut the column and their
+   couplings are left in the residual.
+   ========================================================== */
+
+static void invert_3x3(double *A, double *Ai)
+{
+	int i;
+	double det;
+
+	Ai[0] = A[4] * A[8] - A[5] * A[7];
+	Ai[1] = A[2] * A[7] - A[1] * A[8];
+	Ai[2] = A[1] * A[5] - A[2] * A[4];
+	Ai[3] = A[5] * A[6] - A[3] * A[8];
+	Ai[4] = A[0] * A[8] - A[2] * A[6];
+	Ai[5] = A[2] * A[3] - A[0] * A[5];
+	Ai[6] = A[3] * A[7] - A[4] * A[6];
+	Ai[7] = A[1] * A[6] - A[0] * A[7];
+	Ai[8] = A[0] * A[4] - A[1] * A[3];
+
+	det = 1.0 / (A[0] * Ai[0] + A[1] * Ai[3] + A[2] * Ai[6]);
+	for(i = 0; i < 9; i++)
+		Ai[i] *= det;
+
+	return;
+}
+
+void construct_zline_blocks(struct All_variables *E)
+{
+	static int been_here = 0;
+	int level, nn, ii, jj, kk, j, r, c, eqn, loc0;
+	int nox, noy, noz, nno;
+	double D[9], U[9], *Z;
+	higher_precision *B[3];
+
+	const int dims = E->mesh.nsd;
+	const int max_eqn = max_eqn_interaction[dims];
+
+	for(level = E->mesh.levmax; level >= E->mesh.levmin; level--)
+	{
+		if(level <= E->mesh.levmax - E->control.zline_levels || (E->control.matrix_free && level == E->mesh.levmax))
+			continue;
+
+		nno = E->lmesh.NNO[level];
+		nox = E->lmesh.NOX[level];
+		noy = E->lmesh.NOY[level];
+		noz = E->lmesh.NOZ[level];
+
+		if(!been_here)
+			E->Zln_k[level] = (double *)safe_malloc((nno + 1) * 27 * sizeof(double));
+
+		for(j = 0; j < nno * 27; j++)
+			E->Zln_k[level][j] = 0.0;
+
+		B[0] = E->Eqn_k1[level];
+		B[1] = E->Eqn_k2[level];
+		B[2] = E->Eqn_k3[level];
+
+		for(ii = 1; ii <= noy; ii++)
+			for(jj = 1; jj <= nox; jj++)
+				for(kk = 1; kk <= noz; kk++)
+				{
+					nn = kk + (jj - 1) * noz + (ii - 1) * noz * nox;
+					if(E->NODE[level][nn] & OFFSIDE)
+						continue;
+					Z = E->Zln_k[level] + (nn - 1) * 27;
+					loc0 = (nn - 1) * max_eqn;
+
+					for(r = 0; r < 3; r++)
+						for(c = 0; c < 3; c++)
+							D[r * 3 + c] = B[r][loc0 + c];
+
+					/* velocity bc equations have their whole row and column
+					 * zeroed, gauss_seidel relaxes them with BI */
+					for(r = 0; r < 3; r++)
+						if(D[r * 3 + r] == 0.0)
+							D[r * 3 + r] = 1.0 / E->BI[level][E->ID[level][nn].doff[r + 1]];
+
+					/* K(nn,nn-1) sits in the half row of nn */
+					if(kk > 1 && !(E->NODE[level][nn - 1] & OFFSIDE))
+					{
+						eqn = E->ID[level][nn - 1].doff[1];
+						for(j = 3; j < max_eqn; j += 3)
+							if(E->Node_map[level][loc0 + j] == eqn)
+								break;
+						for(r = 0; r < 3; r++)
+							for(c = 0; c < 3; c++)
+								Z[9 + r * 3 + c] = B[r][loc0 + j + c];
+
+						/* D - L W(nn-1) */
+						for(r = 0; r < 3; r++)
+							for(c = 0; c < 3; c++)
+								D[r * 3 + c] -= Z[9 + r * 3] * Z[-27 + 18 + c] + Z[9 + r * 3 + 1] * Z[-27 + 21 + c] + Z[9 + r * 3 + 2] * Z[-27 + 24 + c];
+					}
+
+					invert_3x3(D, Z);
+
+					/* K(nn,nn+1) is the transpose of K(nn+1,nn) in the half row of nn+1 */
+					if(kk < noz && !(E->NODE[level][nn + 1] & OFFSIDE))
+					{
+						eqn = E->ID[level][nn].doff[1];
+						for(j = 3; j < max_eqn; j += 3)
+							if(E->Node_map[level][loc0 + max_eqn + j] == eqn)
+								break;
+						for(r = 0; r < 3; r++)
+							for(c = 0; c < 3; c++)
+								U[r * 3 + c] = B[c][loc0 + max_eqn + j + r];
+						for(r = 0; r < 3; r++)
+							for(c = 0; c < 3; c++)
+								Z[18 + r * 3 + c] = Z[r * 3] * U[c] + Z[r * 3 + 1] * U[3 + c] + Z[r * 3 + 2] * U[6 + c];
+					}
+				}
+	}
+
+	been_here = 1;
 	return;
 }
 
 
+/* ==========================================================
+   Galerkin coarse operators (galerkin_coarse=on). Below the
+   finest stored level K is replaced by P^T K P, with P the
+   prolongation of interp_vector (injection at the coincident
+   nodes, linear in between), kept in the same half-symmetric
+   Node_map storage. P does not couple processors, so each
+   forms P^T K P from its own part of K and the exchange in
+   n_assemble_del2_u sums them as before. Rows and columns of
+   imposed velocities are dropped as in add_elt_k_to_node_ks,
+   and those equations keep the rediscretised BI. Only the
+   viscous part goes through P^T K P: the fine element-wise
+   augmented Lagrangian term would lock the coarse space, so
+   each level gets its own get_aug_k term instead.
+   ========================================================== */
+
+void construct_galerkin_coarse(struct All_variables *E)
+{
+	int lev, fl, a, i, n, t, s, r, c, k, f1, f2, c1, c2, ix, iy, iz;
+	int nox, noz, noxz, fnox, fnoz, fnoxz, fneq, nno, fnno, neq, loc0, loc1, np[2];
+	int *ci[4], *pn, *node[2];
+	double *wl[4], *wh[4], *pw, *diag, *w[2];
+	double X[3][3], B[3][3], ww, elt_K[24 * 24];
+	higher_precision *Kf[3], *Kc[3], *Ks[3];
+	unsigned int vb[4];
+
+	const int dims = E->mesh.nsd;
+	const int ends = enodes[dims];
+	const int max_eqn = max_eqn_interaction[dims];
+	const int max_blk = max_eqn / dims;
+	const int top = (E->control.matrix_free) ? E->mesh.levmax - 1 : E->mesh.levmax;
+
+	vb[1] = VBX;
+	vb[2] = VBY;
+	vb[3] = VBZ;
+
+	const int lms = loc_mat_size[dims];
+
+	diag = (double *)safe_malloc((E->lmesh.NEQ[E->mesh.levmax] + 2) * sizeof(double));
+	if(E->control.augmented_Lagr)
+		for(r = 0; r < 3; r++)
+			Ks[r] = (higher_precision *) safe_malloc((E->mesh.matrix_size[top] + 1) * sizeof(higher_precision));
+
+	for(lev = top - 1; lev >= E->mesh.levmin; lev--)
+	{
+		fl = lev + 1;
+		nox = E->lmesh.NOX[lev];
+		noz = E->lmesh.NOZ[lev];
+		noxz = nox * noz;
+		nno = E->lmesh.NNO[lev];
+		neq = E->lmesh.NEQ[lev];
+		fnox = E->lmesh.NOX[fl];
+		fnoz = E->lmesh.NOZ[fl];
+		fnoxz = fnox * fnoz;
+		fnno = E->lmesh.NNO[fl];
+		fneq = E->lmesh.NEQ[fl];
+
+		Kf[0] = E->Eqn_k1[fl];
+		Kf[1] = E->Eqn_k2[fl];
+		Kf[2] = E->Eqn_k3[fl];
+		Kc[0] = E->Eqn_k1[lev];
+		Kc[1] = E->Eqn_k2[lev];
+		Kc[2] = E->Eqn_k3[lev];
+
+		if(E->control.augmented_Lagr)
+		{
+			/* a copy of the fine K without its augmented term */
+			for(r = 0; r < 3; r++)
+				for(i = 0; i < E->mesh.matrix_size[fl]; i++)
+					Ks[r][i] = Kf[r][i];
+			E->Eqn_k1[fl] = Ks[0];
+			E->Eqn_k2[fl] = Ks[1];
+			E->Eqn_k3[fl] = Ks[2];
+			for(k = 1; k <= E->lmesh.NEL[fl]; k++)
+			{
+				for(i = 0; i < lms * lms; i++)
+					elt_K[i] = 0.0;
+				get_aug_k(E, k, elt_K, fl);
+				add_elt_k_to_node_ks(E, k, elt_K, fl, -1.0);
+			}
+			E->Eqn_k1[fl] = Kf[0];
+			E->Eqn_k2[fl] = Kf[1];
+			E->Eqn_k3[fl] = Kf[2];
+			for(r = 0; r < 3; r++)
+				Kf[r] = Ks[r];
+		}
+
+		/* 1d interpolation along x (1), y (2) and z (3), with the
+		 * weights interp_vector takes, from a line of the mesh */
+		for(a = 1; a <= 3; a++)
+		{
+			n = (a == 1) ? fnox : ((a == 2) ? E->lmesh.NOY[fl] : fnoz);
+			ci[a] = (int *)safe_malloc((n + 1) * sizeof(int));
+			wl[a] = (double *)safe_malloc((n + 1) * sizeof(double));
+			wh[a] = (double *)safe_malloc((n + 1) * sizeof(double));
+			for(i = 1; i <= n; i++)
+			{
+				ci[a][i] = (i + 1) / 2;
+				wl[a][i] = 1.0;
+				wh[a][i] = 0.0;
+				if(i % 2)
+					continue;
+				k = (a == 1) ? fnoz : ((a == 2) ? fnoxz : 1);
+				f1 = 1 + (i - 1) * k - k;
+				f2 = 1 + (i - 1) * k + k;
+				X[0][0] = E->ECO[fl][E->NEI[fl].element[ends * (f1 - 1)]].size[a];
+				X[0][1] = E->ECO[fl][E->NEI[fl].element[(f2 - 1) * ends]].size[a];
+				wl[a][i] = X[0][1] / (X[0][0] + X[0][1]);
+				wh[a][i] = X[0][0] / (X[0][0] + X[0][1]);
+			}
+		}
+
+		/* coarse nodes and weights of each fine node, at most 8 */
+		pn = (int *)safe_malloc((fnno + 1) * 8 * sizeof(int));
+		pw = (double *)safe_malloc((fnno + 1) * 8 * sizeof(double));
+		for(f1 = 1; f1 <= fnno; f1++)
+		{
+			iz = (f1 - 1) % fnoz + 1;
+			ix = ((f1 - 1) / fnoz) % fnox + 1;
+			iy = (f1 - 1) / fnoxz + 1;
+
+			n = 0;
+			for(t = 0; t < 8; t++)
+			{
+				ww = ((t & 1) ? wh[3][iz] : wl[3][iz]) * ((t & 2) ? wh[1][ix] : wl[1][ix]) * ((t & 4) ? wh[2][iy] : wl[2][iy]);
+				if(ww == 0.0)
+					continue;
+				pn[(f1 - 1) * 8 + n] = ci[3][iz] + (t & 1) + (ci[1][ix] + ((t & 2) ? 1 : 0) - 1) * noz + (ci[2][iy] + ((t & 4) ? 1 : 0) - 1) * noxz;
+				pw[(f1 - 1) * 8 + n] = ww;
+				n++;
+			}
+			for(; n < 8; n++)
+				pn[(f1 - 1) * 8 + n] = 0;
+		}
+
+		for(i = 0; i < E->mesh.matrix_size[lev]; i++)
+			Kc[0][i] = Kc[1][i] = Kc[2][i] = 0.0;
+
+		/* every stored fine block (f1, f2 <= f1) is the ordered pair
+		 * (f1, f2, B) and, off the diagonal, (f2, f1, B^T). Of what
+		 * each gives P^T K P, only the lower (c2 <= c1) half is kept */
+		for(f1 = 1; f1 <= fnno; f1++)
+		{
+			loc1 = (f1 - 1) * max_eqn;
+			for(k = 0; k < max_blk; k++)
+			{
+				if(E->Node_map[fl][loc1 + k * dims] >= fneq)
+					continue;
+				f2 = E->Node_map[fl][loc1 + k * dims] / dims + 1;
+
+				for(r = 0; r < 3; r++)
+					for(c = 0; c < 3; c++)
+						B[r][c] = Kf[r][loc1 + k * dims + c];
+
+				for(t = 0; t < ((f2 == f1) ? 1 : 2); t++)
+				{
+					node[0] = pn + ((t ? f2 : f1) - 1) * 8;
+					node[1] = pn + ((t ? f1 : f2) - 1) * 8;
+					w[0] = pw + ((t ? f2 : f1) - 1) * 8;
+					w[1] = pw + ((t ? f1 : f2) - 1) * 8;
+					for(r = 0; r < 3; r++)
+						for(c = 0; c < 3; c++)
+							X[r][c] = t ? B[c][r] : B[r][c];
+
+					for(np[0] = 0; np[0] < 8 && node[0][np[0]]; np[0]++)
+						for(np[1] = 0; np[1] < 8 && node[1][np[1]]; np[1]++)
+						{
+							c1 = node[0][np[0]];
+							c2 = node[1][np[1]];
+							if(c2 > c1)
+								continue;
+							ww = w[0][np[0]] * w[1][np[1]];
+
+							loc0 = (c1 - 1) * max_eqn;
+							for(s = 0; s < max_blk; s++)
+								if(E->Node_map[lev][loc0 + s * dims] == (c2 - 1) * dims)
+									break;
+							assert(s < max_blk /* P^T K P wider than the node stencil */ );
+							loc0 += s * dims;
+
+							for(r = 0; r < 3; r++)
+							{
+								if(E->NODE[lev][c1] & vb[r + 1])
+									continue;
+								for(c = 0; c < 3; c++)
+									if(!(E->NODE[lev][c2] & vb[c + 1]))
+										Kc[r][loc0 + c] += ww * X[r][c];
+							}
+						}
+				}
+			}
+		}
+
+		if(E->control.augmented_Lagr)
+			for(k = 1; k <= E->lmesh.NEL[lev]; k++)
+			{
+				for(i = 0; i < lms * lms; i++)
+					elt_K[i] = 0.0;
+				get_aug_k(E, k, elt_K, lev);
+				add_elt_k_to_node_ks(E, k, elt_K, lev, 1.0);
+			}
+
+		/* BI from the new diagonal, where there is one */
+		for(i = 0; i <= neq + 1; i++)
+			diag[i] = 0.0;
+		for(c1 = 1; c1 <= nno; c1++)
+		{
+			loc0 = (c1 - 1) * max_eqn;
+			for(r = 0; r < 3; r++)
+				diag[E->ID[lev][c1].doff[r + 1]] = Kc[r][loc0 + r];
+		}
+		exchange_id_d20(E, diag, lev);
+		for(i = 0; i < neq; i++)
+			if(diag[i] != 0.0)
+				E->BI[lev][i] = 1.0 / diag[i];
+
+		E->control.B_is_good[lev] = 0;
+
+		free((void *)pn);
+		free((void *)pw);
+		for(a = 1; a <= 3; a++)
+		{
+			free((void *)ci[a]);
+			free((void *)wl[a]);
+			free((void *)wh[a]);
+		}
+	}
+
+	free((void *)diag);
+	if(E->control.augmented_Lagr)
+		for(r = 0; r < 3; r++)
+			free((void *)Ks[r]);
+
+	return;
+}
+
 
 /* ============================================
    Function to set up the boundary condition
@@ -665,6 +1497,122 @@ void construct_sub_element(struct All_variables *E)
 }
 
 
+/* ==========================================================
+   For cartesian meshes the isotropic element k is
+   sum_k EVI[k] T[k], where T[k] (quadrature weight times the
+   GNX products) is fixed by the element geometry. Elements
+   with the same GNX and GDA share one set of T, which on a
+   structured mesh leaves a few shapes per level, and
+   get_elt_k is reduced to the contraction of T with the
+   integration-point viscosities.
+   ========================================================== */
+
+void construct_elt_k_tensors(struct All_variables *E)
+{
+	int lev, el, s, i, j, k, a, b, p, nel, nshape, ntab, slot;
+	int *table, *first;
+	unsigned int h;
+	double wg, gab, gmax, *T;
+	float *g1, *g2;
+
+	const int dims = E->mesh.nsd;
+	const int ends = enodes[dims];
+	const int vpts = vpoints[dims];
+	const int nent = 9 * ends * (ends + 1) / 2;
+	const int ngnx = dims * ELV * ELN;
+	const int cap = E->control.elt_k_cache_max;
+
+	for(ntab = 1; ntab < 2 * cap; ntab *= 2);
+	table = (int *)safe_malloc(ntab * sizeof(int));
+	first = (int *)safe_malloc(cap * sizeof(int));
+
+	for(lev = E->mesh.levmin; lev <= E->mesh.levmax; lev++)
+	{
+		nel = E->lmesh.NEL[lev];
+		E->Elt_shape[lev] = (int *)safe_malloc((nel + 1) * sizeof(int));
+
+		/* group the elements by their exact geometry */
+		for(i = 0; i < ntab; i++)
+			table[i] = -1;
+		nshape = 0;
+
+		for(el = 1; el <= nel; el++)
+		{
+			/* the float GNX of equal elements differ in the last bits,
+			 * so hash coarsely and compare with a tolerance */
+			g1 = E->GNX[lev][el].vpt;
+			gmax = 0.0;
+			for(i = 0; i < ngnx; i++)
+				gmax = max(gmax, fabs(g1[i]));
+
+			h = 2166136261u;
+			for(i = 0; i < ngnx; i++)
+				h = (h ^ (unsigned int)lrint(1.0e4 * g1[i] / gmax)) * 16777619u;
+
+			E->Elt_shape[lev][el] = -1;
+			for(slot = h & (ntab - 1); table[slot] >= 0; slot = (slot + 1) & (ntab - 1))
+			{
+				s = table[slot];
+				g2 = E->GNX[lev][first[s]].vpt;
+				for(i = 0; i < ngnx && fabs(g1[i] - g2[i]) <= 1.0e-6 * gmax; i++);
+				if(i < ngnx)
+					continue;
+				for(k = 1; k <= vpts; k++)
+					if(fabs(E->GDA[lev][el].vpt[k] - E->GDA[lev][first[s]].vpt[k]) > 1.0e-6 * E->GDA[lev][el].vpt[k])
+						break;
+				if(k <= vpts)
+					continue;
+				E->Elt_shape[lev][el] = s;
+				break;
+			}
+
+			if(E->Elt_shape[lev][el] < 0 && nshape < cap)
+			{					/* new shape, past the cap get_elt_k does it in full */
+				first[nshape] = el;
+				table[slot] = nshape;
+				E->Elt_shape[lev][el] = nshape++;
+			}
+		}
+
+		/* T[k] in the order get_elt_k fills its a <= b blocks */
+		E->Elt_T[lev] = (double *)safe_malloc((nshape * vpts * nent + 1) * sizeof(double));
+		for(s = 0; s < nshape; s++)
+		{
+			g1 = E->GNX[lev][first[s]].vpt;
+			for(k = 1; k <= vpts; k++)
+			{
+				T = E->Elt_T[lev] + (s * vpts + k - 1) * nent;
+				wg = g_point[k].weight[dims - 1] * E->GDA[lev][first[s]].vpt[k];
+				p = 0;
+				for(a = 1; a <= ends; a++)
+					for(b = a; b <= ends; b++)
+					{
+						gab = 0.0;
+						for(i = 0; i < dims; i++)
+						{
+							gab += g1[GNVXINDEX(i, a, k)] * g1[GNVXINDEX(i, b, k)];
+							for(j = 0; j < dims; j++)
+								T[p + 3 * i + j] = wg * g1[GNVXINDEX(j, a, k)] * g1[GNVXINDEX(i, b, k)];
+						}
+						T[p] += wg * gab;
+						T[p + 4] += wg * gab;
+						T[p + 8] += wg * gab;
+						p += 9;
+					}
+			}
+		}
+
+		if(E->control.verbose && E->parallel.me == 0)
+			fprintf(stderr, "level %d: %d element shapes for %d elements\n", lev, nshape, nel);
+	}
+
+	free((void *)table);
+	free((void *)first);
+
+	return;
+}
+
+
 void construct_elt_ks(struct All_variables *E)
 {
   //int e, el, lev, j, k, ii;
@@ -835,8 +1783,9 @@ void construct_stiffness_B_matrix(struct All_variables *E)
 {
 	static int been_here = 0;
 	static int been_here0 = 0;
+	static int rebuilds = 0;
 
-	int i;
+	int i, incremental;
 
 	if(been_here0 == 0)
 	{
@@ -852,10 +1801,15 @@ void construct_stiffness_B_matrix(struct All_variables *E)
 		/* do the following for the 1st time or update_allowed is true */
 
 		if(E->control.NMULTIGRID)
+		{
 			project_viscosity(E);
+			if(E->control.mg_visc_transfer)
+				construct_mg_transfer_weights(E);
+		}
 
 		construct_elt_gs(E);
 
+		incremental = 0;
 		if(E->control.NMULTIGRID || E->control.NASSEMBLE)
 		{
 		  if((been_here == 0)||(E->monitor.solution_cycles == E->control.freeze_surface_at_step) )
@@ -865,14 +1819,33 @@ void construct_stiffness_B_matrix(struct All_variables *E)
 				construct_node_maps(E);
 				been_here = 1;
 			}
-			construct_node_ks(E);
+			else if(E->control.stiffness_update_tol > 0.0 && rebuilds % E->control.stiffness_full_every != 0)
+				incremental = update_node_ks(E);
+
+			if(!incremental)
+			{
+				construct_node_ks(E);
+				rebuilds = 0;
+			}
+			rebuilds++;
+			if(E->control.galerkin_coarse)
+				construct_galerkin_coarse(E);
+			if(E->control.node_gather || E->control.overlap_exchange || E->control.mg_smoother == SMOOTH_COLOUR_GS || E->control.zline_levels)
+				construct_node_rows(E);
+			if(E->control.block_storage)
+				construct_node_blocks(E);
+			if(E->control.stencil_storage)
+				construct_node_stencils(E);
+			if(E->control.zline_levels)
+				construct_zline_blocks(E);
 		}
 		else
 		{
 			construct_elt_ks(E);
 		}
 
-		build_diagonal_of_Ahat(E);
+		if(!incremental)
+			build_diagonal_of_Ahat(E);
 
 
 
@@ -880,6 +1853,12 @@ void construct_stiffness_B_matrix(struct All_variables *E)
 		if(E->control.NMULTIGRID || E->control.NASSEMBLE)
 			rebuild_BI_on_boundary(E);
 
+		if(E->control.NMULTIGRID && (E->control.mg_smoother == SMOOTH_CHEBYSHEV || E->control.matrix_free))
+			estimate_chebyshev_bounds(E);
+
+		if(E->control.NMULTIGRID && E->control.coarse_direct)
+			factor_coarse_operator(E);
+
 
 		been_here0 = 1;
 
@@ -905,6 +1884,9 @@ void rebuild_BI_on_boundary(struct All_variables *E)
 
 	for(level = E->mesh.levmax; level >= E->mesh.levmin; level--)
 	{
+		if(E->control.matrix_free && level == E->mesh.levmax)
+			continue;
+
 		for(j = 0; j <= E->lmesh.NEQ[level] + 1; j++)
 			E->temp[j] = 0.0;
 
@@ -86,6 +86,12 @@ void general_stokes_solver(struct All_variables *E)
 	  oldU[i] = E->U[i];
       }
     } /* end iterate */
+    E->nhist = 0;
+    if(E->control.stokes_extrapolate)
+      for(i = 0; i <= E->control.stokes_extrapolate; i++){
+	E->Uhist[i] = (double *)safe_malloc(neq * sizeof(double));
+	E->Phist[i] = (double *)safe_malloc((E->lmesh.npno + 1) * sizeof(double));
+      }
     visits++;
   }
   
@@ -102,6 +108,9 @@ void general_stokes_solver(struct All_variables *E)
   if(E->parallel.me == 0)
     time = CPU_time0();
   
+  if(E->control.stokes_extrapolate)
+    extrapolate_stokes_solution(E);
+
   velocities_conform_bcs(E, E->U);
 
   assemble_forces(E, 0);
@@ -132,7 +141,12 @@ void general_stokes_solver(struct All_variables *E)
     E->monitor.visc_iter_count++;
 	  
     if(iterate){		/* iterations are neeeded */
-      if(damp){
+      if(E->viscosity.sdepv_anderson){
+	anderson_mix(E, oldU, alpha, E->monitor.visc_iter_count == 1);
+	/* the viscosity of the next iteration is computed from V */
+	v_from_vector(E, E->V, E->U);
+      }
+      else if(damp){
 	/* add some of the old solution */
 	for(i = 0; i < neq; i++)
 	  E->U[i] = alpha * E->U[i] + alpha1 * oldU[i];
@@ -160,11 +174,191 @@ void general_stokes_solver(struct All_variables *E)
   if(iterate){			/* free the delta_U array */
     free((void *)delta_U);
   }
+  if(E->control.stokes_extrapolate)
+    store_stokes_solution(E);
   //if(E->parallel.me==0)fprintf(stderr,"stokes solver done\n");
   return;
 }
 
 
+/* 
+
+   the last stokes_extrapolate+1 solutions are kept in a ring buffer,
+   and the initial guess for the next solve is their Lagrange
+   extrapolation (linear or quadratic) to the current time
+
+*/
+void store_stokes_solution(struct All_variables *E)
+{
+  int i, slot;
+  const int neq = E->lmesh.neq;
+  const int npno = E->lmesh.npno;
+
+  slot = E->nhist % (E->control.stokes_extrapolate + 1);
+  for(i = 0; i < neq; i++)
+    E->Uhist[slot][i] = E->U[i];
+  for(i = 1; i <= npno; i++)
+    E->Phist[slot][i] = E->P[i];
+  E->thist[slot] = E->monitor.elapsed_time;
+  E->nhist++;
+
+  return;
+}
+
+void extrapolate_stokes_solution(struct All_variables *E)
+{
+  int i, j, k, n, nh, slot[3];
+  double w[3], t;
+  const int neq = E->lmesh.neq;
+  const int npno = E->lmesh.npno;
+
+  nh = E->control.stokes_extrapolate + 1;
+  n = min(E->nhist, nh);
+  if(n < 2)
+    return;
+
+  t = E->monitor.elapsed_time;
+  for(k = 0; k < n; k++)	/* newest first */
+    slot[k] = (E->nhist - 1 - k) % nh;
+
+  for(k = 0; k < n; k++){
+    w[k] = 1.0;
+    for(j = 0; j < n; j++)
+      if(j != k){
+	if(E->thist[slot[k]] == E->thist[slot[j]])
+	  return;
+	w[k] *= (t - E->thist[slot[j]]) / (E->thist[slot[k]] - E->thist[slot[j]]);
+      }
+  }
+
+  for(i = 0; i < neq; i++){
+    E->U[i] = 0.0;
+    for(k = 0; k < n; k++)
+      E->U[i] += w[k] * E->Uhist[slot[k]][i];
+  }
+  for(i = 1; i <= npno; i++){
+    E->P[i] = 0.0;
+    for(k = 0; k < n; k++)
+      E->P[i] += w[k] * E->Phist[slot[k]][i];
+  }
+
+  return;
+}
+
+
+/* 
+
+   Anderson mixing for the stress dependent viscosity iteration: U
+   holds the Picard update G(x) of the previous iterate x = oldU and is
+   replaced by the combination of the last sdepv_anderson updates that
+   minimises the linearised residual G(x) - x, damped by beta
+   (sdepv_iter_damp). A restart drops the history.
+
+*/
+void anderson_mix(struct All_variables *E, double *oldU, double beta, int restart)
+{
+  static int been_here = 0;
+  static double **DF, **DG, *fprev, *gprev, *A, *gam;
+  static int head, nstored;
+  int i, j, k, n, p;
+  double s, piv, *dots;
+
+  const int neq = E->lmesh.neq;
+  const int lev = E->mesh.levmax;
+  const int m = E->viscosity.sdepv_anderson;
+
+  if(been_here == 0){
+    DF = (double **)safe_malloc(m * sizeof(double *));
+    DG = (double **)safe_malloc(m * sizeof(double *));
+    for(k = 0; k < m; k++){
+      DF[k] = (double *)safe_malloc(neq * sizeof(double));
+      DG[k] = (double *)safe_malloc(neq * sizeof(double));
+    }
+    fprev = (double *)safe_malloc(neq * sizeof(double));
+    gprev = (double *)safe_malloc(neq * sizeof(double));
+    A = (double *)safe_malloc((m * m + m * (m + 3) / 2) * sizeof(double));
+    gam = (double *)safe_malloc(m * sizeof(double));
+    been_here = 1;
+  }
+
+  if(restart){
+    head = nstored = 0;
+  }else{
+    for(i = 0; i < neq; i++){
+      DF[head][i] = (E->U[i] - oldU[i]) - fprev[i];
+      DG[head][i] = E->U[i] - gprev[i];
+    }
+    head = (head + 1) % m;
+    nstored = min(nstored + 1, m);
+  }
+  for(i = 0; i < neq; i++){
+    fprev[i] = E->U[i] - oldU[i];
+    gprev[i] = E->U[i];
+  }
+
+  n = nstored;
+  if(n == 0){
+    for(i = 0; i < neq; i++)
+      E->U[i] = oldU[i] + beta * fprev[i];
+    return;
+  }
+
+  /* normal equations DF^T DF gam = DF^T f, in one reduction; the
+     packed lower triangle and right side take n(n+3)/2 slots */
+  dots = A + m * m;
+  p = 0;
+  for(j = 0; j < n; j++){
+    for(k = 0; k <= j; k++)
+      dots[p++] = local_vdot(E, DF[j], DF[k], lev);
+    dots[p++] = local_vdot(E, DF[j], fprev, lev);
+  }
+  global_sums(E, dots, p);
+
+  p = 0;
+  for(j = 0; j < n; j++){
+    for(k = 0; k <= j; k++){
+      A[j * n + k] = A[k * n + j] = dots[p++];
+    }
+    gam[j] = dots[p++];
+    A[j * n + j] *= 1.0 + 1.0e-10;	/* the history can be nearly dependent */
+  }
+
+  /* Gaussian elimination; A is symmetric positive semi-definite */
+  for(k = 0; k < n; k++){
+    piv = A[k * n + k];
+    if(piv <= 0.0){
+      gam[k] = 0.0;
+      continue;
+    }
+    for(j = k + 1; j < n; j++){
+      s = A[j * n + k] / piv;
+      for(i = k; i < n; i++)
+	A[j * n + i] -= s * A[k * n + i];
+      gam[j] -= s * gam[k];
+    }
+  }
+  for(k = n - 1; k >= 0; k--){
+    if(A[k * n + k] <= 0.0){
+      gam[k] = 0.0;
+      continue;
+    }
+    for(i = k + 1; i < n; i++)
+      gam[k] -= A[k * n + i] * gam[i];
+    gam[k] /= A[k * n + k];
+  }
+
+  /* x = G - DG gam - (1 - beta) (f - DF gam) */
+  for(i = 0; i < neq; i++){
+    s = gprev[i] - (1.0 - beta) * fprev[i];
+    for(k = 0; k < n; k++)
+      s -= gam[k] * (DG[k][i] - (1.0 - beta) * DF[k][i]);
+    E->U[i] = s;
+  }
+
+  return;
+}
+
+
 int need_to_iterate(struct All_variables *E){
   if(E->control.force_initial_stokes_iteration && (E->monitor.solution_cycles == 0))
     return 1;
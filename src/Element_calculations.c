@@ -141,8 +141,8 @@ void get_elt_k(struct All_variables *E, int el, double elt_k[24 * 24], int lev,
 
 
   int pn, qn, ad, bd;
-  int a, b, i, j, k;
-  double temp;
+  int a, b, i, j, k, p, cached;
+  double temp, B[9 * 36], *T;
 
 #ifdef CITCOM_ALLOW_ANISOTROPIC_VISC
   double D[VPOINTS3D+1][6][6],btmp[6];
@@ -155,10 +155,26 @@ void get_elt_k(struct All_variables *E, int el, double elt_k[24 * 24], int lev,
   const int vpts = vpoints[E->mesh.nsd];
   const int ends = enodes[E->mesh.nsd];
   const int dims = E->mesh.nsd;
+  const int nent = 9 * ends * (ends + 1) / 2;
   const double one = 1.0;
   const double two = 2.0;
 
 
+  cached = E->control.elt_k_cache && E->Elt_shape[lev][el] >= 0;
+  if(cached){
+    /* the geometry is in the tensors of construct_elt_k_tensors,
+       only the viscosities at the integration points vary */
+    T = E->Elt_T[lev] + E->Elt_shape[lev][el] * vpts * nent;
+    for(p = 0; p < nent; p++)
+      B[p] = 0.0;
+    for(k = 1; k <= vpts; k++, T += nent){
+      temp = E->EVI[lev][(el - 1) * vpts + k];
+      for(p = 0; p < nent; p++)
+	B[p] += temp * T[p];
+    }
+  }
+  p = 0;
+
   if(E->control.Rsphere)	/* need rtf for spherical */
     get_rtf(E, el, 0, rtf, lev); /* vpts */
   for(k = 1; k <= vpts; k++){
@@ -220,7 +236,18 @@ void get_elt_k(struct All_variables *E, int el, double elt_k[24 * 24], int lev,
 	the spherical version uses B
 
 	*/
-      if(E->control.CART3D){
+      if(cached){
+	bdbmu[1][1] = B[p];
+	bdbmu[1][2] = B[p + 1];
+	bdbmu[1][3] = B[p + 2];
+	bdbmu[2][1] = B[p + 3];
+	bdbmu[2][2] = B[p + 4];
+	bdbmu[2][3] = B[p + 5];
+	bdbmu[3][1] = B[p + 6];
+	bdbmu[3][2] = B[p + 7];
+	bdbmu[3][3] = B[p + 8];
+	p += 9;
+      }else if(E->control.CART3D){
 	/* cartesian isotropic does not use ba[] */
 	for(k = 1; k <= vpts; k++){
 	  bdbmu[1][1] += W[k] * E->GNX[lev][el].vpt[GNVXINDEX(0, a, k)] * E->GNX[lev][el].vpt[GNVXINDEX(0, b, k)];
@@ -552,62 +579,200 @@ void e_assemble_del2_u(struct All_variables *E, double *u, double *Au, int level
 void n_assemble_del2_u(struct All_variables *E, double *u, double *Au, int level, int strip_bcs)
 {
 	//int node, e, i, eqn1, eqn2, eqn3, loc0, loc1, loc2, loc3;
-	int e, i, eqn1, eqn2, eqn3, loc0; 
+	int e, i, j, eqn1, eqn2, eqn3, loc0; 
+	int off[14];
 
-	double U1, U2, U3, UU;
+	double U1, U2, U3, UU, A1, A2, A3;
 
 	static int been_here = 0;
 
 	int *C;
-	higher_precision *B1, *B2, *B3;
+	higher_precision *B1, *B2, *B3, *K;
 
 	const int neq = E->lmesh.NEQ[level];
 	const int nno = E->lmesh.NNO[level];
 	const int dims = E->mesh.nsd;
 	//const int dofs = E->mesh.dof;
 	const int max_eqn = max_eqn_interaction[dims];
+	const int max_row = 2 * max_eqn - dims;
+	const int max_blk = max_eqn / dims;
 
-	for(e = 0; e <= neq + 1; e++)
-		Au[e] = 0.0;
+	if(E->control.matrix_free && level == E->mesh.levmax)
+	{
+		mf_assemble_del2_u(E, u, Au, level, strip_bcs);
+		return;
+	}
 
-	u[neq + 1] = 0;
-	loc0 = 1;
+	if(E->control.overlap_exchange)
+	{
+		overlap_assemble_del2_u(E, u, Au, level, strip_bcs);
+		return;
+	}
+
+	if(E->control.node_gather)
+	{
+		/* every row is complete, so each node only writes its own
+		 * equations and the loop can be shared between threads.
+		 * The summation order does not depend on the thread count */
+
+		u[neq + 1] = 0;
+		Au[neq] = Au[neq + 1] = 0.0;
+
+#pragma omp parallel for private(i, eqn1, eqn2, eqn3, U1, U2, U3, UU, C, B1, B2, B3) schedule(static)
+		for(e = 1; e <= nno; e++)
+		{
+			C = E->Row_map[level] + (e - 1) * max_row;
+			B1 = E->Row_k1[level] + (e - 1) * max_row;
+			B2 = E->Row_k2[level] + (e - 1) * max_row;
+			B3 = E->Row_k3[level] + (e - 1) * max_row;
+
+			U1 = U2 = U3 = 0.0;
+			for(i = 0; i < max_row; i++)
+			{
+				UU = u[C[i]];
+				U1 += B1[i] * UU;
+				U2 += B2[i] * UU;
+				U3 += B3[i] * UU;
+			}
+
+			eqn1 = E->ID[level][e].doff[1];
+			eqn2 = E->ID[level][e].doff[2];
+			eqn3 = E->ID[level][e].doff[3];
+			Au[eqn1] = U1;
+			Au[eqn2] = U2;
+			Au[eqn3] = U3;
+		}
+	}
+	else if(E->control.block_storage)
+	{
+		/* same half-symmetric sweep on 3x3 blocks: one index per
+		 * neighbour node, whose equations are consecutive */
+
+		for(e = 0; e <= neq + 1; e++)
+			Au[e] = 0.0;
+
+		u[neq + 1] = 0;
+
+		for(e = 1; e <= nno; e++)
+		{
+			eqn1 = E->ID[level][e].doff[1];
+			U1 = u[eqn1];
+			U2 = u[eqn1 + 1];
+			U3 = u[eqn1 + 2];
+
+			C = E->Blk_map[level] + (e - 1) * max_blk;
+			K = E->Blk_k[level] + (e - 1) * max_blk * 9;
+
+			/* diagonal block */
+			A1 = K[0] * U1 + K[1] * U2 + K[2] * U3;
+			A2 = K[3] * U1 + K[4] * U2 + K[5] * U3;
+			A3 = K[6] * U1 + K[7] * U2 + K[8] * U3;
+
+			for(i = 1; i < max_blk; i++)
+			{
+				K += 9;
+				j = C[i];
+				A1 += K[0] * u[j] + K[1] * u[j + 1] + K[2] * u[j + 2];
+				A2 += K[3] * u[j] + K[4] * u[j + 1] + K[5] * u[j + 2];
+				A3 += K[6] * u[j] + K[7] * u[j + 1] + K[8] * u[j + 2];
+				Au[j] += K[0] * U1 + K[3] * U2 + K[6] * U3;
+				Au[j + 1] += K[1] * U1 + K[4] * U2 + K[7] * U3;
+				Au[j + 2] += K[2] * U1 + K[5] * U2 + K[8] * U3;
+			}
 
-	for(e = 1; e <= nno; e++)
+			Au[eqn1] += A1;
+			Au[eqn1 + 1] += A2;
+			Au[eqn1 + 2] += A3;
+		}
+	}
+	else if(E->control.stencil_storage)
 	{
+		/* the same sweep on the structured stencil, neighbour
+		 * equations follow from the node numbering */
+
+		node_stencil_offsets(E, level, off);
+
+		for(e = 0; e <= neq + 1; e++)
+			Au[e] = 0.0;
+
+		u[neq + 1] = 0;
+
+		for(e = 1; e <= nno; e++)
+		{
+			eqn1 = dims * (e - 1);
+			U1 = u[eqn1];
+			U2 = u[eqn1 + 1];
+			U3 = u[eqn1 + 2];
+
+			K = E->Stn_k[level] + (e - 1) * max_blk * 9;
 
-		eqn1 = E->ID[level][e].doff[1];
-		eqn2 = E->ID[level][e].doff[2];
-		eqn3 = E->ID[level][e].doff[3];
+			A1 = K[0] * U1 + K[1] * U2 + K[2] * U3;
+			A2 = K[3] * U1 + K[4] * U2 + K[5] * U3;
+			A3 = K[6] * U1 + K[7] * U2 + K[8] * U3;
 
-		U1 = u[eqn1];
-		U2 = u[eqn2];
-		U3 = u[eqn3];
+			for(i = 1; i < max_blk; i++)
+			{
+				K += 9;
+				if(off[i] >= e)
+					continue;	/* below node 1, zero block */
+				j = eqn1 - dims * off[i];
+				A1 += K[0] * u[j] + K[1] * u[j + 1] + K[2] * u[j + 2];
+				A2 += K[3] * u[j] + K[4] * u[j + 1] + K[5] * u[j + 2];
+				A3 += K[6] * u[j] + K[7] * u[j + 1] + K[8] * u[j + 2];
+				Au[j] += K[0] * U1 + K[3] * U2 + K[6] * U3;
+				Au[j + 1] += K[1] * U1 + K[4] * U2 + K[7] * U3;
+				Au[j + 2] += K[2] * U1 + K[5] * U2 + K[8] * U3;
+			}
+
+			Au[eqn1] += A1;
+			Au[eqn1 + 1] += A2;
+			Au[eqn1 + 2] += A3;
+		}
+	}
+	else
+	{
+		for(e = 0; e <= neq + 1; e++)
+			Au[e] = 0.0;
 
-		C = E->Node_map[level] + (e - 1) * max_eqn;
-		B1 = E->Eqn_k1[level] + (e - 1) * max_eqn;
-		B2 = E->Eqn_k2[level] + (e - 1) * max_eqn;
-		B3 = E->Eqn_k3[level] + (e - 1) * max_eqn;
+		u[neq + 1] = 0;
+		loc0 = 1;
 
-		for(i = 3; i < max_eqn; i++)
+		for(e = 1; e <= nno; e++)
 		{
-			UU = u[C[i]];
-			Au[eqn1] += B1[i] * UU;
-			Au[eqn2] += B2[i] * UU;
-			Au[eqn3] += B3[i] * UU;
+
+			eqn1 = E->ID[level][e].doff[1];
+			eqn2 = E->ID[level][e].doff[2];
+			eqn3 = E->ID[level][e].doff[3];
+
+			U1 = u[eqn1];
+			U2 = u[eqn2];
+			U3 = u[eqn3];
+
+			C = E->Node_map[level] + (e - 1) * max_eqn;
+			B1 = E->Eqn_k1[level] + (e - 1) * max_eqn;
+			B2 = E->Eqn_k2[level] + (e - 1) * max_eqn;
+			B3 = E->Eqn_k3[level] + (e - 1) * max_eqn;
+
+			for(i = 3; i < max_eqn; i++)
+			{
+				UU = u[C[i]];
+				Au[eqn1] += B1[i] * UU;
+				Au[eqn2] += B2[i] * UU;
+				Au[eqn3] += B3[i] * UU;
+			}
+			/* contributions to the current node or equation from other
+			 * adjacent nodes or d.o.f.. Use horizontal entries of the
+			 * stiffness matrix. Not completed yet, since we only store
+			 * half of the matrix */
+
+			for(i = 0; i < max_eqn; i++)
+				Au[C[i]] += B1[i] * U1 + B2[i] * U2 + B3[i] * U3;
+
+			/* contributions from the current node to other nodes or
+			 * eqns including current node (i=0 to max_eqn). 
+			 * Use vertical entries of the stiffness matrix and the
+			 * symmetry. This ultimately will complete the assembly */
 		}
-		/* contributions to the current node or equation from other
-		 * adjacent nodes or d.o.f.. Use horizontal entries of the
-		 * stiffness matrix. Not completed yet, since we only store
-		 * half of the matrix */
-
-		for(i = 0; i < max_eqn; i++)
-			Au[C[i]] += B1[i] * U1 + B2[i] * U2 + B3[i] * U3;
-
-		/* contributions from the current node to other nodes or
-		 * eqns including current node (i=0 to max_eqn). 
-		 * Use vertical entries of the stiffness matrix and the
-		 * symmetry. This ultimately will complete the assembly */
 	}
 
 	exchange_id_d20(E, Au, level);
@@ -621,6 +786,224 @@ void n_assemble_del2_u(struct All_variables *E, double *u, double *Au, int level
 }
 
 
+	/* ======================================================
+	 * K*u with the halo exchange overlapped (overlap_exchange=on).
+	 * From the full rows (Row_map/Row_k) the OFFSIDE nodes, the
+	 * only ones exchange_id_d20 reads or writes, are done first.
+	 * Their exchange is started and the interior rows follow in
+	 * chunks, between which the exchange is moved on, so that
+	 * all three passes can complete behind the computation. The
+	 * result is the same as node_gather=on.
+	 * ====================================================== */
+
+#define OVERLAP_CHUNK 4096
+
+void overlap_assemble_del2_u(struct All_variables *E, double *u, double *Au, int level, int strip_bcs)
+{
+	int e, k, n, i, c, eqn1, eqn2, eqn3;
+	int *C;
+	double U1, U2, U3, UU;
+	higher_precision *B1, *B2, *B3;
+
+	static int *order[MAX_LEVELS], nb[MAX_LEVELS];
+
+	const int neq = E->lmesh.NEQ[level];
+	const int nno = E->lmesh.NNO[level];
+	const int max_row = 2 * max_eqn_interaction[E->mesh.nsd] - E->mesh.nsd;
+
+	if(order[level] == NULL)
+	{
+		/* OFFSIDE nodes first, nb of them */
+		order[level] = (int *)safe_malloc((nno + 1) * sizeof(int));
+		n = 0;
+		for(e = 1; e <= nno; e++)
+			if(E->NODE[level][e] & OFFSIDE)
+				order[level][n++] = e;
+		nb[level] = n;
+		for(e = 1; e <= nno; e++)
+			if(!(E->NODE[level][e] & OFFSIDE))
+				order[level][n++] = e;
+	}
+
+	u[neq + 1] = 0;
+	Au[neq] = Au[neq + 1] = 0.0;
+
+	for(c = 0; c < nno; c = n)
+	{
+		n = (c < nb[level]) ? nb[level] : min(c + OVERLAP_CHUNK, nno);
+
+#pragma omp parallel for private(e, i, eqn1, eqn2, eqn3, U1, U2, U3, UU, C, B1, B2, B3) schedule(static)
+		for(k = c; k < n; k++)
+		{
+			e = order[level][k];
+			C = E->Row_map[level] + (e - 1) * max_row;
+			B1 = E->Row_k1[level] + (e - 1) * max_row;
+			B2 = E->Row_k2[level] + (e - 1) * max_row;
+			B3 = E->Row_k3[level] + (e - 1) * max_row;
+
+			U1 = U2 = U3 = 0.0;
+			for(i = 0; i < max_row; i++)
+			{
+				UU = u[C[i]];
+				U1 += B1[i] * UU;
+				U2 += B2[i] * UU;
+				U3 += B3[i] * UU;
+			}
+
+			eqn1 = E->ID[level][e].doff[1];
+			eqn2 = E->ID[level][e].doff[2];
+			eqn3 = E->ID[level][e].doff[3];
+			Au[eqn1] = U1;
+			Au[eqn2] = U2;
+			Au[eqn3] = U3;
+		}
+
+		if(c == 0)
+			exchange_id_d20_begin(E, Au, level);
+		else
+			exchange_id_d20_progress(E);
+	}
+
+	exchange_id_d20_end(E);
+
+	if(strip_bcs)
+		strip_bcs_from_residual(E, Au, level);
+
+	return;
+}
+
+
+	/* ======================================================
+	 * Matrix-free K*u for the finest level (matrix_free=on,
+	 * cartesian isotropic only). At every integration point
+	 * the velocity gradient G is formed from GNX and the
+	 * element's u, and Au_a += W dN_a . (G + G^T), which is
+	 * the same operator get_elt_k (+ get_aug_k) builds. Rows
+	 * and columns of imposed velocities are dropped, as in
+	 * construct_node_ks. Elements are coloured by parity so
+	 * that each colour scatters without conflicts.
+	 * ====================================================== */
+
+void mf_assemble_del2_u(struct All_variables *E, double *u, double *Au, int level, int strip_bcs)
+{
+	int e, el, i, j, k, a, c, node, off;
+	int elx, elz, ix, iy, iz;
+	double ue[9][4], ae[9][4], G[4][4], S[4][4];
+	double W, div, visc;
+	float *gnx;
+
+	static int been_here = 0;
+	static double *um;
+	static int *colour_el, colour_start[9];
+
+	const int dims = E->mesh.nsd;
+	const int ends = enodes[dims];
+	const int vpts = vpoints[dims];
+	const int neq = E->lmesh.NEQ[level];
+	const int nel = E->lmesh.NEL[level];
+
+	if(been_here == 0)
+	{
+		um = (double *)safe_malloc((neq + 2) * sizeof(double));
+		colour_el = (int *)safe_malloc((nel + 1) * sizeof(int));
+		elx = E->lmesh.ELX[level];
+		elz = E->lmesh.ELZ[level];
+		k = 0;
+		for(c = 0; c < 8; c++)
+		{
+			colour_start[c] = k;
+			for(el = 1; el <= nel; el++)
+			{
+				iz = (el - 1) % elz;
+				ix = ((el - 1) / elz) % elx;
+				iy = (el - 1) / (elz * elx);
+				if((iz % 2) + 2 * (ix % 2) + 4 * (iy % 2) == c)
+					colour_el[k++] = el;
+			}
+		}
+		colour_start[8] = k;
+		been_here++;
+	}
+
+	for(i = 0; i < neq; i++)
+	{
+		um[i] = u[i];
+		Au[i] = 0.0;
+	}
+	strip_bcs_from_residual(E, um, level);
+
+	for(c = 0; c < 8; c++)
+	{
+#pragma omp parallel for private(el, i, j, k, a, node, off, ue, ae, G, S, W, div, visc, gnx) schedule(static)
+		for(e = colour_start[c]; e < colour_start[c + 1]; e++)
+		{
+			el = colour_el[e];
+			gnx = E->GNX[level][el].vpt;
+
+			for(a = 1; a <= ends; a++)
+				for(i = 1; i <= dims; i++)
+				{
+					ue[a][i] = um[E->LMD[level][el].node[a].doff[i]];
+					ae[a][i] = 0.0;
+				}
+
+			visc = 0.0;
+			for(k = 1; k <= vpts; k++)
+			{
+				off = (el - 1) * vpts + k;
+				visc += E->EVI[level][off];
+				W = g_point[k].weight[dims - 1] * E->GDA[level][el].vpt[k] * E->EVI[level][off];
+
+				for(i = 1; i <= dims; i++)
+					for(j = 1; j <= dims; j++)
+					{
+						G[i][j] = 0.0;
+						for(a = 1; a <= ends; a++)
+							G[i][j] += ue[a][i] * gnx[GNVXINDEX(j - 1, a, k)];
+					}
+				for(i = 1; i <= dims; i++)
+					for(j = 1; j <= dims; j++)
+						S[i][j] = W * (G[i][j] + G[j][i]);
+
+				for(a = 1; a <= ends; a++)
+					for(i = 1; i <= dims; i++)
+						ae[a][i] += gnx[GNVXINDEX(0, a, k)] * S[i][1] + gnx[GNVXINDEX(1, a, k)] * S[i][2] + gnx[GNVXINDEX(2, a, k)] * S[i][3];
+			}
+
+			if(E->control.augmented_Lagr)
+			{
+				/* get_aug_k: K += visc * aug * g g^T, visc averaged over the element */
+				visc = visc / vpts * E->control.augmented;
+				div = 0.0;
+				for(a = 1; a <= ends; a++)
+					for(i = 1; i <= dims; i++)
+						div += E->elt_del[level][el].g[(a - 1) * dims + i - 1][0] * ue[a][i];
+				for(a = 1; a <= ends; a++)
+					for(i = 1; i <= dims; i++)
+						ae[a][i] += visc * E->elt_del[level][el].g[(a - 1) * dims + i - 1][0] * div;
+			}
+
+			for(a = 1; a <= ends; a++)
+			{
+				node = E->IEN[level][el].node[a];
+				for(i = 1; i <= dims; i++)
+					Au[E->ID[level][node].doff[i]] += ae[a][i];
+			}
+		}
+	}
+
+	u[neq + 1] = 0.0;
+	Au[neq] = Au[neq + 1] = 0.0;
+
+	exchange_id_d20(E, Au, level);
+
+	if(strip_bcs)
+		strip_bcs_from_residual(E, Au, level);
+
+	return;
+}
+
+
 void build_diagonal_of_K(struct All_variables *E, int el, double elt_k[24 * 24], int level)
 
 {
@@ -651,6 +1034,25 @@ void build_diagonal_of_K(struct All_variables *E, int el, double elt_k[24 * 24],
 	return;
 }
 
+/* inverse of the 1/eta weighted pressure mass matrix entry of
+ * element e, 1/int(1/eta)dV: the harmonic, not arithmetic, mean of
+ * the viscosity over the element, so that a few stiff integration
+ * points do not dominate */
+double visc_mass_entry(struct All_variables *E, int e, int level)
+{
+	int j;
+	double m;
+
+	const int dims = E->mesh.nsd;
+	const int vpts = vpoints[dims];
+
+	m = 0.0;
+	for(j = 1; j <= vpts; j++)
+		m += g_point[j].weight[dims - 1] * E->GDA[level][e].vpt[j] / E->EVI[level][(e - 1) * vpts + j];
+
+	return (1.0 / m);
+}
+
 void build_diagonal_of_Ahat(struct All_variables *E)
 {
 	double BU;
@@ -664,6 +1066,10 @@ void build_diagonal_of_Ahat(struct All_variables *E)
 		npno = E->lmesh.NPNO[level];
 		neq = E->lmesh.NEQ[level];
 
+		/* the (diagonal) 1/eta weighted pressure mass matrix, inverted */
+		for(e = 1; e <= npno; e++)
+			E->BPM[level][e] = visc_mass_entry(E, e, level);
+
 		for(e = 1; e <= npno; e++)
 			E->BPI[level][e] = 1.0;
 
@@ -466,6 +466,9 @@ int solve_del2_u(struct All_variables *E, double *d0, double *F,
 		 * }
 		 */
 		valid = (residual < acc) ? 0 : 1;
+		if(E->control.mg_fcg)
+			residual = mg_fcg(E, d0, r, acc, &count, high_lev);
+		else
 		while(residual > acc)
 		{
 			residual = multi_grid(E, D1, r, Au, acc, high_lev);
@@ -571,7 +574,10 @@ double multi_grid(struct All_variables *E, double *d1, double *F, double *Au, do
 
 	cycles = E->control.v_steps_low;
 /*    (void) conj_grad(E,vel[levmin],fl[levmin],AU[levmin],acc*0.001,&cycles,levmin); 
- */ gauss_seidel(E, vel[levmin], fl[levmin], AU[levmin], acc * 0.01, &cycles, levmin, 0);
+ */ if(E->control.coarse_direct)
+		coarse_direct_solve(E, vel[levmin], fl[levmin], AU[levmin]);
+	else
+		mg_smooth(E, vel[levmin], fl[levmin], AU[levmin], acc * 0.01, &cycles, levmin, 0);
 
 	for(lev = levmin + 1; lev <= levmax; lev++)
 	{
@@ -594,7 +600,7 @@ double multi_grid(struct All_variables *E, double *d1, double *F, double *Au, do
 				/* Pre-smoothing  */
 				cycles = ((dlev == levmax) ? E->control.v_steps_high : E->control.down_heavy);
 				ic = ((dlev == lev) ? 1 : 0);
-				gauss_seidel(E, vel[dlev], rhs[dlev], AU[dlev], 0.01, &cycles, dlev, ic);
+				mg_smooth(E, vel[dlev], rhs[dlev], AU[dlev], 0.01, &cycles, dlev, ic);
 
 				/* Update residual  */
 				for(i = 0; i < E->lmesh.NEQ[dlev]; i++)
@@ -610,7 +616,10 @@ double multi_grid(struct All_variables *E, double *d1, double *F, double *Au, do
 			/*    Bottom of the V    */
 			cycles = E->control.v_steps_low;
 /*      (void) conj_grad(E,vel[levmin],rhs[levmin],AU[levmin],acc*0.001,&cycles,levmin); 
-*/ gauss_seidel(E, vel[levmin], rhs[levmin], AU[levmin], acc * 0.01, &cycles, levmin, 0);
+*/ if(E->control.coarse_direct)
+				coarse_direct_solve(E, vel[levmin], rhs[levmin], AU[levmin]);
+			else
+				mg_smooth(E, vel[levmin], rhs[levmin], AU[levmin], acc * 0.01, &cycles, levmin, 0);
 
 
 			/*    Upward stoke of the V    */
@@ -621,7 +630,7 @@ double multi_grid(struct All_variables *E, double *d1, double *F, double *Au, do
 
 				interp_vector(E, ulev - 1, vel[ulev - 1], del_vel[ulev]);
 				strip_bcs_from_residual(E, del_vel[ulev], ulev);
-				gauss_seidel(E, del_vel[ulev], res[ulev], AU[ulev], 0.01, &cycles, ulev, 1);
+				mg_smooth(E, del_vel[ulev], res[ulev], AU[ulev], 0.01, &cycles, ulev, 1);
 
 				AudotAu = global_vdot(E, AU[ulev], AU[ulev], ulev);
 				alpha = global_vdot(E, AU[ulev], res[ulev], ulev) / AudotAu;
@@ -658,6 +667,106 @@ double multi_grid(struct All_variables *E, double *d1, double *F, double *Au, do
     ===========================================================  */
 
 
+/* ==========================================================
+   Flexible conjugate gradients with one multi_grid V-cycle
+   as the preconditioner. The V-cycle (with its line search
+   on the upward stroke) is not a fixed linear operator,
+   hence the flexible (Polak-Ribiere) form of beta. At most
+   mg_fcg_iterations V-cycles are used per solve.
+   ========================================================== */
+
+double mg_fcg(struct All_variables *E, double *d0, double *F, double acc, int *cycles, int hl)
+{
+	static double *r, *z, *t, *p, *Ap, *Az;
+	static int been_here = 0;
+
+	int count, i;
+	double residual, alpha, beta, dots[2], pAp;
+
+	const int neq = E->lmesh.NEQ[hl];
+	const int gneq = E->mesh.NEQ[hl];
+
+	if(0 == been_here)
+	{
+		r = (double *)safe_malloc((2 + E->lmesh.NEQ[E->mesh.levmax]) * sizeof(double));
+		z = (double *)safe_malloc((2 + E->lmesh.NEQ[E->mesh.levmax]) * sizeof(double));
+		t = (double *)safe_malloc((2 + E->lmesh.NEQ[E->mesh.levmax]) * sizeof(double));
+		p = (double *)safe_malloc((2 + E->lmesh.NEQ[E->mesh.levmax]) * sizeof(double));
+		Ap = (double *)safe_malloc((2 + E->lmesh.NEQ[E->mesh.levmax]) * sizeof(double));
+		Az = (double *)safe_malloc((2 + E->lmesh.NEQ[E->mesh.levmax]) * sizeof(double));
+		been_here++;
+	}
+
+	for(i = 0; i < neq; i++)
+	{
+		r[i] = F[i];
+		z[i] = 0.0;
+	}
+
+	residual = sqrt(global_vdot(E, r, r, hl) / gneq);
+	pAp = 0.0;
+	count = 0;
+
+	while(residual > acc && count < E->control.mg_fcg_iterations)
+	{
+		/* multi_grid leaves r - A z in its right hand side,
+		 * which gives A z without another matrix product */
+		for(i = 0; i < neq; i++)
+			t[i] = r[i];
+		(void)multi_grid(E, z, t, Az, acc, hl);
+		for(i = 0; i < neq; i++)
+			Az[i] = r[i] - t[i];
+
+		if(0 == count)
+			for(i = 0; i < neq; i++)
+			{
+				p[i] = z[i];
+				Ap[i] = Az[i];
+			}
+		else
+		{
+			beta = global_vdot(E, z, Ap, hl) / pAp;
+			for(i = 0; i < neq; i++)
+			{
+				p[i] = z[i] - beta * p[i];
+				Ap[i] = Az[i] - beta * Ap[i];
+			}
+		}
+
+		dots[0] = local_vdot(E, p, r, hl);
+		dots[1] = local_vdot(E, p, Ap, hl);
+		global_sums(E, dots, 2);
+		pAp = dots[1];
+
+		if(0.0 == pAp)
+			break;
+		alpha = dots[0] / pAp;
+
+		for(i = 0; i < neq; i++)
+		{
+			d0[i] += alpha * p[i];
+			r[i] -= alpha * Ap[i];
+		}
+
+		residual = sqrt(global_vdot(E, r, r, hl) / gneq);
+		count++;
+
+		if(E->monitor.solution_cycles % 5 == 0 && E->parallel.me == 0)
+			fprintf(E->fp, "resi = %.6e for fcg iter %d acc %.6e\n", residual, count, acc);
+	}
+
+	if((residual > acc) && (E->parallel.me == 0))
+		fprintf(stderr, "mg_fcg: WARNING: res: %.3e > acc: %.3e after %d iterations\n", residual, acc, count);
+
+	*cycles = count;
+
+	for(i = 0; i < neq; i++)
+		F[i] = r[i];
+
+	return (residual);
+}
+
+
 double conj_grad(struct All_variables *E, double *d0, double *F, double *Au, double acc, int *cycles, int level)
 {
 	static double *r0, *r1, *r2;
@@ -800,6 +909,7 @@ void jacobi(struct All_variables *E, double *d0, double *F, double *Ad, double a
 	}
 
 
+	(void)acc;
 	steps = *cycles;
 	count = 0;
 
@@ -911,6 +1021,7 @@ void element_gauss_seidel(struct All_variables *E, double *d0, double *F, double
 	const int nno = E->lmesh.NNO[level];
 
 
+	(void)acc;
 	steps = *cycles;
 
 	if(0 == been_here)
@@ -1095,6 +1206,7 @@ void gauss_seidel1(struct All_variables *E, double *d0, double *F, double *Ad, d
 	//const int noy = E->lmesh.NOZ[level];
 	const int max_eqn = max_eqn_interaction[dims];
 
+	(void)acc;
 	steps = *cycles;
 
 	if(guess)
@@ -1161,8 +1273,8 @@ void gauss_seidel(struct All_variables *E, double *d0, double *F, double *Ad, do
 {
 
 	//int count, i, j, k, l, m, ns, steps;
-	int count, i, j, steps;
-	int *C;
+	int count, i, j, k, steps;
+	int *C, off[14];
 	int eqn1, eqn2, eqn3;
 
 	//double residual, *r, UU, U1, U2, U3;
@@ -1172,7 +1284,7 @@ void gauss_seidel(struct All_variables *E, double *d0, double *F, double *Ad, do
 	static higher_precision *temp1, *temp;
 
 	//higher_precision node_k[4][81];
-	higher_precision *B1, *B2, *B3;
+	higher_precision *B1, *B2, *B3, *B, *K;
 
 
 	const int dims = E->mesh.nsd;
@@ -1184,9 +1296,14 @@ void gauss_seidel(struct All_variables *E, double *d0, double *F, double *Ad, do
 	//const int noz = E->lmesh.NOY[level];
 	//const int noy = E->lmesh.NOZ[level];
 	const int max_eqn = max_eqn_interaction[dims];
+	const int max_blk = max_eqn / dims;
 
+	(void)acc;
 	steps = *cycles;
 
+	if(E->control.stencil_storage)
+		node_stencil_offsets(E, level, off);
+
 	if(guess)
 	{
 		d0[neq] = 0.0;
@@ -1228,6 +1345,78 @@ void gauss_seidel(struct All_variables *E, double *d0, double *F, double *Ad, do
 					temp1[eqn2] = Ad[eqn2];
 					temp1[eqn3] = Ad[eqn3];
 				}
+			if(E->control.block_storage)
+				for(i = 1; i <= nno; i++)
+				{
+					eqn1 = E->ID[level][i].doff[1];
+					C = E->Blk_map[level] + (i - 1) * max_blk;
+					K = E->Blk_k[level] + (i - 1) * max_blk * 9;
+
+					for(j = 1; j < max_blk; j++)
+					{
+						B = K + 9 * j;
+						k = C[j];
+						Ad[eqn1] += B[0] * temp[k] + B[1] * temp[k + 1] + B[2] * temp[k + 2];
+						Ad[eqn1 + 1] += B[3] * temp[k] + B[4] * temp[k + 1] + B[5] * temp[k + 2];
+						Ad[eqn1 + 2] += B[6] * temp[k] + B[7] * temp[k + 1] + B[8] * temp[k + 2];
+					}
+					if(!(E->NODE[level][i] & OFFSIDE))
+					{
+						temp[eqn1] = (F[eqn1] - Ad[eqn1]) * E->BI[level][eqn1];
+						temp[eqn1 + 1] = (F[eqn1 + 1] - Ad[eqn1 + 1]) * E->BI[level][eqn1 + 1];
+						temp[eqn1 + 2] = (F[eqn1 + 2] - Ad[eqn1 + 2]) * E->BI[level][eqn1 + 2];
+					}
+					for(j = 0; j < max_blk; j++)
+					{
+						B = K + 9 * j;
+						k = C[j];
+						Ad[k] += B[0] * temp[eqn1] + B[3] * temp[eqn1 + 1] + B[6] * temp[eqn1 + 2];
+						Ad[k + 1] += B[1] * temp[eqn1] + B[4] * temp[eqn1 + 1] + B[7] * temp[eqn1 + 2];
+						Ad[k + 2] += B[2] * temp[eqn1] + B[5] * temp[eqn1 + 1] + B[8] * temp[eqn1 + 2];
+					}
+
+					d0[eqn1] += temp[eqn1];
+					d0[eqn1 + 1] += temp[eqn1 + 1];
+					d0[eqn1 + 2] += temp[eqn1 + 2];
+				}
+			else if(E->control.stencil_storage)
+				for(i = 1; i <= nno; i++)
+				{
+					eqn1 = dims * (i - 1);
+					K = E->Stn_k[level] + (i - 1) * max_blk * 9;
+
+					for(j = 1; j < max_blk; j++)
+					{
+						if(off[j] >= i)
+							continue;
+						B = K + 9 * j;
+						k = eqn1 - dims * off[j];
+						Ad[eqn1] += B[0] * temp[k] + B[1] * temp[k + 1] + B[2] * temp[k + 2];
+						Ad[eqn1 + 1] += B[3] * temp[k] + B[4] * temp[k + 1] + B[5] * temp[k + 2];
+						Ad[eqn1 + 2] += B[6] * temp[k] + B[7] * temp[k + 1] + B[8] * temp[k + 2];
+					}
+					if(!(E->NODE[level][i] & OFFSIDE))
+					{
+						temp[eqn1] = (F[eqn1] - Ad[eqn1]) * E->BI[level][eqn1];
+						temp[eqn1 + 1] = (F[eqn1 + 1] - Ad[eqn1 + 1]) * E->BI[level][eqn1 + 1];
+						temp[eqn1 + 2] = (F[eqn1 + 2] - Ad[eqn1 + 2]) * E->BI[level][eqn1 + 2];
+					}
+					for(j = 0; j < max_blk; j++)
+					{
+						if(off[j] >= i)
+							continue;
+						B = K + 9 * j;
+						k = eqn1 - dims * off[j];
+						Ad[k] += B[0] * temp[eqn1] + B[3] * temp[eqn1 + 1] + B[6] * temp[eqn1 + 2];
+						Ad[k + 1] += B[1] * temp[eqn1] + B[4] * temp[eqn1 + 1] + B[7] * temp[eqn1 + 2];
+						Ad[k + 2] += B[2] * temp[eqn1] + B[5] * temp[eqn1 + 1] + B[8] * temp[eqn1 + 2];
+					}
+
+					d0[eqn1] += temp[eqn1];
+					d0[eqn1 + 1] += temp[eqn1 + 1];
+					d0[eqn1 + 2] += temp[eqn1 + 2];
+				}
+			else
 			for(i = 1; i <= nno; i++)
 			{
 				eqn1 = E->ID[level][i].doff[1];
@@ -1360,6 +1549,636 @@ void gauss_seidel(struct All_variables *E, double *d0, double *F, double *Ad, do
 
 }
 
+/* ==========================================================
+   Multicolour Gauss-Seidel. Nodes are split into 8 colours by
+   the parity of their (x,z,y) index: no two nodes of the same
+   colour share an element, so each colour can be relaxed by
+   all threads at once from the full rows (Row_map/Row_k).
+   Processor boundary (OFFSIDE) nodes take one Jacobi step
+   from the assembled Ad first, as in gauss_seidel, so the
+   shared d.o.f. stay consistent between processors.
+   ========================================================== */
+
+void colour_gauss_seidel(struct All_variables *E, double *d0, double *F, double *Ad, double acc, int *cycles, int level, int guess)
+{
+	int count, i, j, k, c, node, steps;
+	int nox, noz, ix, iz, iy;
+	int *C;
+	int eqn1, eqn2, eqn3;
+
+	double UU, U1, U2, U3;
+	static int been_here = 0;
+	static int *colour_node[MAX_LEVELS];
+	static int colour_start[MAX_LEVELS][10];
+
+	higher_precision *B1, *B2, *B3;
+
+	const int dims = E->mesh.nsd;
+	const int neq = E->lmesh.NEQ[level];
+	const int max_row = 2 * max_eqn_interaction[dims] - dims;
+
+	if(been_here == 0)
+	{
+		for(i = E->mesh.levmin; i <= E->mesh.levmax; i++)
+		{
+			colour_node[i] = (int *)safe_malloc((E->lmesh.NNO[i] + 1) * sizeof(int));
+			nox = E->lmesh.NOX[i];
+			noz = E->lmesh.NOZ[i];
+
+			/* colours 0-7 are interior nodes, 8 the OFFSIDE ones */
+			k = 0;
+			for(c = 0; c <= 8; c++)
+			{
+				colour_start[i][c] = k;
+				for(node = 1; node <= E->lmesh.NNO[i]; node++)
+				{
+					iz = (node - 1) % noz;
+					ix = ((node - 1) / noz) % nox;
+					iy = (node - 1) / (noz * nox);
+					j = (E->NODE[i][node] & OFFSIDE) ? 8 : (iz % 2) + 2 * (ix % 2) + 4 * (iy % 2);
+					if(j == c)
+						colour_node[i][k++] = node;
+				}
+			}
+			colour_start[i][9] = k;
+		}
+		been_here++;
+	}
+
+	(void)acc;
+	steps = *cycles;
+
+	if(guess)
+	{
+		d0[neq] = 0.0;
+		n_assemble_del2_u(E, d0, Ad, level, 1);
+	}
+	else
+		for(i = 0; i < neq; i++)
+		{
+			d0[i] = Ad[i] = 0.0;
+		}
+	d0[neq + 1] = 0.0;
+
+	for(count = 0; count < steps; count++)
+	{
+		for(k = colour_start[level][8]; k < colour_start[level][9]; k++)
+		{
+			node = colour_node[level][k];
+			eqn1 = E->ID[level][node].doff[1];
+			eqn2 = E->ID[level][node].doff[2];
+			eqn3 = E->ID[level][node].doff[3];
+			d0[eqn1] += (F[eqn1] - Ad[eqn1]) * E->BI[level][eqn1];
+			d0[eqn2] += (F[eqn2] - Ad[eqn2]) * E->BI[level][eqn2];
+			d0[eqn3] += (F[eqn3] - Ad[eqn3]) * E->BI[level][eqn3];
+		}
+
+		for(c = 0; c < 8; c++)
+		{
+#pragma omp parallel for private(i, node, eqn1, eqn2, eqn3, UU, U1, U2, U3, C, B1, B2, B3) schedule(static)
+			for(k = colour_start[level][c]; k < colour_start[level][c + 1]; k++)
+			{
+				node = colour_node[level][k];
+				C = E->Row_map[level] + (node - 1) * max_row;
+				B1 = E->Row_k1[level] + (node - 1) * max_row;
+				B2 = E->Row_k2[level] + (node - 1) * max_row;
+				B3 = E->Row_k3[level] + (node - 1) * max_row;
+
+				U1 = U2 = U3 = 0.0;
+				for(i = 0; i < max_row; i++)
+				{
+					UU = d0[C[i]];
+					U1 += B1[i] * UU;
+					U2 += B2[i] * UU;
+					U3 += B3[i] * UU;
+				}
+
+				eqn1 = E->ID[level][node].doff[1];
+				eqn2 = E->ID[level][node].doff[2];
+				eqn3 = E->ID[level][node].doff[3];
+				d0[eqn1] += (F[eqn1] - U1) * E->BI[level][eqn1];
+				d0[eqn2] += (F[eqn2] - U2) * E->BI[level][eqn2];
+				d0[eqn3] += (F[eqn3] - U3) * E->BI[level][eqn3];
+			}
+		}
+
+		/* Ad is needed for the next OFFSIDE step and by the caller */
+		n_assemble_del2_u(E, d0, Ad, level, 1);
+	}
+
+	*cycles = count;
+
+	return;
+}
+
+
+/* ==========================================================
+   z-line Gauss-Seidel (zline_levels > 0). Every vertical
+   column of nodes is relaxed at once by solving the 3x3 block
+   tridiagonal system along it (construct_zline_blocks) for
+   the full-row residual. With the strong radial refinement
+   and depth layered viscosity the vertical couplings dominate
+   and point relaxation hardly touches the long wavelengths in
+   z. Columns are coloured by the parity of (x,y), so columns
+   of one colour do not see each other and are threaded.
+   OFFSIDE nodes are handled as in colour_gauss_seidel.
+   ========================================================== */
+
+void zline_gauss_seidel(struct All_variables *E, double *d0, double *F, double *Ad, double acc, int *cycles, int level, int guess)
+{
+	int count, i, k, c, col, ix, iy, node, steps;
+	int eqn1, eqn2, eqn3;
+	int *C;
+
+	double UU, U1, U2, U3, *Z, *g0;
+	static int been_here = 0;
+	static double *g;
+
+	higher_precision *B1, *B2, *B3;
+
+	const int dims = E->mesh.nsd;
+	const int neq = E->lmesh.NEQ[level];
+	const int nno = E->lmesh.NNO[level];
+	const int nox = E->lmesh.NOX[level];
+	const int noz = E->lmesh.NOZ[level];
+	const int noy = E->lmesh.NOY[level];
+	const int max_row = 2 * max_eqn_interaction[dims] - dims;
+
+	if(been_here == 0)
+	{
+		g = (double *)safe_malloc((E->lmesh.NEQ[E->mesh.levmax] + 2) * sizeof(double));
+		for(i = 0; i < E->lmesh.NEQ[E->mesh.levmax] + 2; i++)
+			g[i] = 0.0;
+		been_here++;
+	}
+
+	(void)acc;
+	steps = *cycles;
+
+	if(guess)
+	{
+		d0[neq] = 0.0;
+		n_assemble_del2_u(E, d0, Ad, level, 1);
+	}
+	else
+		for(i = 0; i < neq; i++)
+		{
+			d0[i] = Ad[i] = 0.0;
+		}
+	d0[neq + 1] = 0.0;
+
+	for(count = 0; count < steps; count++)
+	{
+		for(node = 1; node <= nno; node++)
+			if(E->NODE[level][node] & OFFSIDE)
+			{
+				eqn1 = E->ID[level][node].doff[1];
+				eqn2 = E->ID[level][node].doff[2];
+				eqn3 = E->ID[level][node].doff[3];
+				d0[eqn1] += (F[eqn1] - Ad[eqn1]) * E->BI[level][eqn1];
+				d0[eqn2] += (F[eqn2] - Ad[eqn2]) * E->BI[level][eqn2];
+				d0[eqn3] += (F[eqn3] - Ad[eqn3]) * E->BI[level][eqn3];
+			}
+
+		for(c = 0; c < 4; c++)
+		{
+#pragma omp parallel for private(i, k, ix, iy, node, eqn1, UU, U1, U2, U3, C, B1, B2, B3, Z, g0) schedule(static)
+			for(col = 0; col < nox * noy; col++)
+			{
+				ix = col % nox;
+				iy = col / nox;
+				if((ix % 2) + 2 * (iy % 2) != c)
+					continue;
+
+				/* forward elimination of the residual down the column */
+				for(k = 1; k <= noz; k++)
+				{
+					node = k + ix * noz + iy * noz * nox;
+					if(E->NODE[level][node] & OFFSIDE)
+						continue;
+					C = E->Row_map[level] + (node - 1) * max_row;
+					B1 = E->Row_k1[level] + (node - 1) * max_row;
+					B2 = E->Row_k2[level] + (node - 1) * max_row;
+					B3 = E->Row_k3[level] + (node - 1) * max_row;
+
+					U1 = U2 = U3 = 0.0;
+					for(i = 0; i < max_row; i++)
+					{
+						UU = d0[C[i]];
+						U1 += B1[i] * UU;
+						U2 += B2[i] * UU;
+						U3 += B3[i] * UU;
+					}
+
+					eqn1 = E->ID[level][node].doff[1];
+					U1 = F[eqn1] - U1;
+					U2 = F[eqn1 + 1] - U2;
+					U3 = F[eqn1 + 2] - U3;
+
+					Z = E->Zln_k[level] + (node - 1) * 27;
+					if(k > 1)
+					{
+						g0 = g + eqn1 - 3;
+						U1 -= Z[9] * g0[0] + Z[10] * g0[1] + Z[11] * g0[2];
+						U2 -= Z[12] * g0[0] + Z[13] * g0[1] + Z[14] * g0[2];
+						U3 -= Z[15] * g0[0] + Z[16] * g0[1] + Z[17] * g0[2];
+					}
+					g[eqn1] = Z[0] * U1 + Z[1] * U2 + Z[2] * U3;
+					g[eqn1 + 1] = Z[3] * U1 + Z[4] * U2 + Z[5] * U3;
+					g[eqn1 + 2] = Z[6] * U1 + Z[7] * U2 + Z[8] * U3;
+				}
+
+				/* and back substitution */
+				for(k = noz; k >= 1; k--)
+				{
+					node = k + ix * noz + iy * noz * nox;
+					if(E->NODE[level][node] & OFFSIDE)
+						continue;
+					eqn1 = E->ID[level][node].doff[1];
+					Z = E->Zln_k[level] + (node - 1) * 27;
+					if(k < noz)
+					{
+						g0 = g + eqn1 + 3;
+						g[eqn1] -= Z[18] * g0[0] + Z[19] * g0[1] + Z[20] * g0[2];
+						g[eqn1 + 1] -= Z[21] * g0[0] + Z[22] * g0[1] + Z[23] * g0[2];
+						g[eqn1 + 2] -= Z[24] * g0[0] + Z[25] * g0[1] + Z[26] * g0[2];
+					}
+					d0[eqn1] += g[eqn1];
+					d0[eqn1 + 1] += g[eqn1 + 1];
+					d0[eqn1 + 2] += g[eqn1 + 2];
+				}
+			}
+		}
+
+		/* Ad is needed for the next OFFSIDE step and by the caller */
+		n_assemble_del2_u(E, d0, Ad, level, 1);
+	}
+
+	*cycles = count;
+
+	return;
+}
+
+
+/* ==========================================================
+   Chebyshev smoother with Jacobi (BI) scaling. Each of the
+   *cycles steps costs one n_assemble_del2_u, like a sweep of
+   gauss_seidel, but has no ordering dependency. The target
+   interval [lmax/cheb_eig_ratio, lmax] of the spectrum of
+   BI*K comes from estimate_chebyshev_bounds.
+   ========================================================== */
+
+void chebyshev_smoother(struct All_variables *E, double *d0, double *F, double *Ad, double acc, int *cycles, int level, int guess)
+{
+	int count, i, steps;
+	double theta, delta, sigma, rho, rho1;
+
+	static int been_here = 0;
+	static double *dk, *Adk;
+
+	const int neq = E->lmesh.NEQ[level];
+
+	if(been_here == 0)
+	{
+		dk = (double *)safe_malloc((E->lmesh.NEQ[E->mesh.levmax] + 2) * sizeof(double));
+		Adk = (double *)safe_malloc((E->lmesh.NEQ[E->mesh.levmax] + 2) * sizeof(double));
+		been_here++;
+	}
+
+	(void)acc;
+	steps = *cycles;
+
+	if(guess)
+	{
+		d0[neq] = 0.0;
+		n_assemble_del2_u(E, d0, Ad, level, 1);
+	}
+	else
+		for(i = 0; i < neq; i++)
+		{
+			d0[i] = Ad[i] = 0.0;
+		}
+
+	theta = 0.5 * E->control.cheb_lmax[level] * (1.0 + 1.0 / E->control.cheb_eig_ratio);
+	delta = 0.5 * E->control.cheb_lmax[level] * (1.0 - 1.0 / E->control.cheb_eig_ratio);
+	sigma = theta / delta;
+	rho = 1.0 / sigma;
+
+	for(i = 0; i < neq; i++)
+		dk[i] = (F[i] - Ad[i]) * E->BI[level][i] / theta;
+
+	for(count = 0; count < steps; count++)
+	{
+		if(count > 0)
+		{
+			rho1 = 1.0 / (2.0 * sigma - rho);
+			for(i = 0; i < neq; i++)
+				dk[i] = rho1 * rho * dk[i] + 2.0 * rho1 / delta * (F[i] - Ad[i]) * E->BI[level][i];
+			rho = rho1;
+		}
+
+		strip_bcs_from_residual(E, dk, level);
+		n_assemble_del2_u(E, dk, Adk, level, 1);
+
+#pragma omp parallel for schedule(static)
+		for(i = 0; i < neq; i++)
+		{
+			d0[i] += dk[i];
+			Ad[i] += Adk[i];
+		}
+	}
+
+	*cycles = count;
+
+	return;
+}
+
+
+/* ==========================================================
+   Largest eigenvalue of BI*K on every level by power
+   iterations, redone whenever the stiffness matrix is
+   rebuilt. The start vector is a pseudo-random hash of the
+   global node position, so that shared nodes agree.
+   ========================================================== */
+
+void estimate_chebyshev_bounds(struct All_variables *E)
+{
+	int lev, i, k, node, neq, nno, nox, noz, gx, gy, gz, d;
+	unsigned int h;
+	double *x, *Ax, *Dx, lambda, xAx, xDx, norm;
+
+	const int dims = E->mesh.nsd;
+
+	x = (double *)safe_malloc((E->lmesh.NEQ[E->mesh.levmax] + 2) * sizeof(double));
+	Ax = (double *)safe_malloc((E->lmesh.NEQ[E->mesh.levmax] + 2) * sizeof(double));
+	Dx = (double *)safe_malloc((E->lmesh.NEQ[E->mesh.levmax] + 2) * sizeof(double));
+
+	for(lev = E->mesh.levmax; lev >= E->mesh.levmin; lev--)
+	{
+		neq = E->lmesh.NEQ[lev];
+		nno = E->lmesh.NNO[lev];
+		nox = E->lmesh.NOX[lev];
+		noz = E->lmesh.NOZ[lev];
+
+		for(node = 1; node <= nno; node++)
+		{
+			gz = E->lmesh.NZS[lev] + (node - 1) % noz;
+			gx = E->lmesh.NXS[lev] + ((node - 1) / noz) % nox;
+			gy = E->lmesh.NYS[lev] + (node - 1) / (noz * nox);
+			for(d = 1; d <= dims; d++)
+			{
+				i = E->ID[lev][node].doff[d];
+				h = ((unsigned int)gx * 73856093u) ^ ((unsigned int)gy * 19349663u) ^ ((unsigned int)gz * 83492791u) ^ ((unsigned int)d * 2654435761u);
+				h = h * 1103515245u + 12345u;
+				x[i] = (double)(h % 20001) / 10000.0 - 1.0;
+			}
+		}
+		x[neq] = x[neq + 1] = 0.0;
+		strip_bcs_from_residual(E, x, lev);
+
+		lambda = 1.0;
+		for(k = 0; k < E->control.cheb_power_its; k++)
+		{
+			n_assemble_del2_u(E, x, Ax, lev, 1);
+
+			for(i = 0; i < neq; i++)
+				Dx[i] = x[i] / E->BI[lev][i];
+			xAx = global_vdot(E, x, Ax, lev);
+			xDx = global_vdot(E, x, Dx, lev);
+			for(i = 0; i < neq; i++)
+				Ax[i] *= E->BI[lev][i];
+			lambda = xAx / xDx;
+
+			norm = sqrt(global_vdot(E, Ax, Ax, lev));
+			for(i = 0; i < neq; i++)
+				x[i] = Ax[i] / norm;
+		}
+
+		/* power iterations approach lmax from below */
+		E->control.cheb_lmax[lev] = 1.1 * lambda;
+
+		if(E->control.print_convergence && E->parallel.me == 0)
+			fprintf(E->fp, "Chebyshev smoother: level %d lmax(BI*K) = %g\n", lev, E->control.cheb_lmax[lev]);
+	}
+
+	free((void *)x);
+	free((void *)Ax);
+	free((void *)Dx);
+
+	return;
+}
+
+
+/* ==========================================================
+   Smoother used by multi_grid, chosen by mg_smoother. The
+   Chebyshev polynomial only damps the upper part of the
+   spectrum, so the coarsest level is still solved by
+   gauss_seidel. Without stored coefficients (matrix_free)
+   the finest level can only use the Chebyshev smoother.
+   The zline_levels finest levels use z-line relaxation
+   whatever mg_smoother says.
+   ========================================================== */
+
+void mg_smooth(struct All_variables *E, double *d0, double *F, double *Ad, double acc, int *cycles, int level, int guess)
+{
+	if(E->control.matrix_free && level == E->mesh.levmax)
+		chebyshev_smoother(E, d0, F, Ad, acc, cycles, level, guess);
+	else if(level > E->mesh.levmax - E->control.zline_levels)
+		zline_gauss_seidel(E, d0, F, Ad, acc, cycles, level, guess);
+	else if(E->control.mg_smoother == SMOOTH_COLOUR_GS)
+		colour_gauss_seidel(E, d0, F, Ad, acc, cycles, level, guess);
+	else if(E->control.mg_smoother == SMOOTH_CHEBYSHEV && level > E->mesh.levmin)
+		chebyshev_smoother(E, d0, F, Ad, acc, cycles, level, guess);
+	else
+		gauss_seidel(E, d0, F, Ad, acc, cycles, level, guess);
+
+	return;
+}
+
+
+/* ==========================================================
+   Direct solver for the coarsest multigrid level. Every
+   processor sums its part of the levmin operator into the
+   lower band of a global matrix, which is Cholesky factorised
+   redundantly once per stiffness rebuild. With the global
+   nodes numbered z first, then x, then y, neighbours are at
+   most 1+NOZ+NOZ*NOX nodes apart, and the factor keeps that
+   band. Row i holds columns i-bw..i at Coarse_K[bw*(i+1)+c].
+   A V-cycle then needs one reduction of the right hand side
+   and two banded triangular solves in place of v_steps_low
+   sweeps.
+   ========================================================== */
+
+void factor_coarse_operator(struct All_variables *E)
+{
+	static int been_here = 0;
+	int i, j, k, j0, d, node, r, c, gx, gy, gz, bw;
+	size_t l, size;
+	double s, *Li, *Lj;
+	int *C;
+	higher_precision *B[4];
+
+	const int lev = E->mesh.levmin;
+	const int dims = E->mesh.nsd;
+	const int max_eqn = max_eqn_interaction[dims];
+	const int neq = E->lmesh.NEQ[lev];
+	const int nno = E->lmesh.NNO[lev];
+	const int nox = E->lmesh.NOX[lev];
+	const int noz = E->lmesh.NOZ[lev];
+	const int n = E->mesh.NEQ[lev];
+
+	if(been_here == 0)
+	{
+		if(n > E->control.coarse_direct_max || E->mesh.matrix_size[lev] == 0)
+		{
+			if(E->parallel.me == 0)
+				fprintf(stderr, "coarse_direct: %d equations on level %d, using gauss_seidel instead\n", n, lev);
+			E->control.coarse_direct = 0;
+			return;
+		}
+
+		/* global equation of each local one */
+		E->Coarse_id = (int *)safe_malloc((neq + 2) * sizeof(int));
+		for(node = 1; node <= nno; node++)
+		{
+			gz = E->lmesh.NZS[lev] + (node - 1) % noz;
+			gx = E->lmesh.NXS[lev] + ((node - 1) / noz) % nox;
+			gy = E->lmesh.NYS[lev] + (node - 1) / (noz * nox);
+			c = gz + (gx - 1) * E->mesh.NOZ[lev] + (gy - 1) * E->mesh.NOZ[lev] * E->mesh.NOX[lev];
+			for(d = 1; d <= dims; d++)
+				E->Coarse_id[E->ID[lev][node].doff[d]] = dims * (c - 1) + d - 1;
+		}
+		E->Coarse_id[neq] = E->Coarse_id[neq + 1] = -1;
+
+		bw = 1 + E->mesh.NOZ[lev];
+		if(dims == 3)
+			bw += E->mesh.NOZ[lev] * E->mesh.NOX[lev];
+		E->Coarse_bw = dims * bw + dims - 1;
+
+		E->Coarse_K = (double *)safe_malloc((size_t) (E->Coarse_bw + 1) * n * sizeof(double));
+		been_here = 1;
+	}
+
+	bw = E->Coarse_bw;
+	size = (size_t) (bw + 1) * n;
+
+	for(l = 0; l < size; l++)
+		E->Coarse_K[l] = 0.0;
+
+	B[1] = E->Eqn_k1[lev];
+	B[2] = E->Eqn_k2[lev];
+	B[3] = E->Eqn_k3[lev];
+
+	for(node = 1; node <= nno; node++)
+	{
+		C = E->Node_map[lev] + (node - 1) * max_eqn;
+		for(d = 1; d <= dims; d++)
+		{
+			r = E->Coarse_id[E->ID[lev][node].doff[d]];
+			for(j = 0; j < max_eqn; j++)
+			{
+				if(C[j] >= neq)
+					continue;
+				c = E->Coarse_id[C[j]];
+				if(j < dims && c > r)
+					continue;	/* the node's own block is stored whole */
+				if(c > r)
+					E->Coarse_K[(size_t) bw * (c + 1) + r] += B[d][(node - 1) * max_eqn + j];
+				else
+					E->Coarse_K[(size_t) bw * (r + 1) + c] += B[d][(node - 1) * max_eqn + j];
+			}
+		}
+	}
+
+	global_sums(E, E->Coarse_K, size);
+
+	/* velocity boundary conditions leave empty rows */
+	for(i = 0; i < n; i++)
+		if(E->Coarse_K[(size_t) bw * (i + 1) + i] == 0.0)
+			E->Coarse_K[(size_t) bw * (i + 1) + i] = 1.0;
+
+	for(i = 0; i < n; i++)
+	{
+		Li = E->Coarse_K + (size_t) bw * (i + 1);
+		j0 = max(0, i - bw);
+		for(j = j0; j <= i; j++)
+		{
+			Lj = E->Coarse_K + (size_t) bw * (j + 1);
+			s = Li[j];
+			for(k = j0; k < j; k++)
+				s -= Li[k] * Lj[k];
+			if(j < i)
+				Li[j] = s / Lj[j];
+			else if(s > 0.0)
+				Li[i] = sqrt(s);
+			else
+			{
+				if(E->parallel.me == 0)
+					fprintf(stderr, "coarse_direct: level %d operator is not positive definite, using gauss_seidel instead\n", lev);
+				E->control.coarse_direct = 0;
+				return;
+			}
+		}
+	}
+
+	return;
+}
+
+
+void coarse_direct_solve(struct All_variables *E, double *d0, double *F, double *Ad)
+{
+	static int been_here = 0;
+	static double *b;
+	int i, k;
+	double s, *Li;
+
+	const int lev = E->mesh.levmin;
+	const int neq = E->lmesh.NEQ[lev];
+	const int n = E->mesh.NEQ[lev];
+	const int bw = E->Coarse_bw;
+
+	if(been_here == 0)
+	{
+		b = (double *)safe_malloc((n + 1) * sizeof(double));
+		been_here = 1;
+	}
+
+	for(i = 0; i < n; i++)
+		b[i] = 0.0;
+	for(i = 0; i < neq; i++)
+		if(E->parallel.IDD[lev][i])
+			b[E->Coarse_id[i]] = F[i];
+
+	global_sums(E, b, n);
+
+	for(i = 0; i < n; i++)
+	{
+		Li = E->Coarse_K + (size_t) bw * (i + 1);
+		s = b[i];
+		for(k = max(0, i - bw); k < i; k++)
+			s -= Li[k] * b[k];
+		b[i] = s / Li[i];
+	}
+	for(i = n - 1; i >= 0; i--)
+	{
+		Li = E->Coarse_K + (size_t) bw * (i + 1);
+		b[i] /= Li[i];
+		for(k = max(0, i - bw); k < i; k++)
+			b[k] -= Li[k] * b[i];
+	}
+
+	/* the solve is exact, so K*d0 is the right hand side */
+	for(i = 0; i < neq; i++)
+	{
+		d0[i] = b[E->Coarse_id[i]];
+		Ad[i] = F[i];
+	}
+	d0[neq] = 0.0;
+
+	return;
+}
+
+
 void print_elt_k(struct All_variables *E, double a[24 * 24])
 {
 	int l, ll, n;
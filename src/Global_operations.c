@@ -46,6 +46,27 @@
 #include "element_definitions.h"
 #include "global_defs.h"
 
+/* ==========================================================
+   Communicators for the layer and column reductions below,
+   made once by setup_layer_comms at start up (collective
+   over MPI_COMM_WORLD): the processors of my horizontal
+   layer (same me_loc[3]), over which the horizontal averages
+   and the surface sums run, and those of my vertical column
+   (same me_loc[1], me_loc[2]). Ranks keep their order in
+   MPI_COMM_WORLD, so the rank in the column is me_loc[3].
+   ========================================================== */
+
+static MPI_Comm horiz_comm = MPI_COMM_NULL;
+static MPI_Comm vert_comm = MPI_COMM_NULL;
+
+void setup_layer_comms(struct All_variables *E)
+{
+	MPI_Comm_split(MPI_COMM_WORLD, E->parallel.me_loc[3], E->parallel.me, &horiz_comm);
+	MPI_Comm_split(MPI_COMM_WORLD, E->parallel.me_loc[1] + E->parallel.me_loc[2] * E->parallel.nprocx, E->parallel.me, &vert_comm);
+
+	return;
+}
+
 /* ===============================================
    strips horizontal average from nodal field X. 
    Assumes orthogonal mesh, otherwise, horizontals
@@ -81,91 +102,52 @@ void remove_horiz_ave(struct All_variables *E, float *X, float *H, int store_or_
 
 void return_horiz_sum(struct All_variables *E, float *X, float *H, int nn)
 {
-	//const int dims = E->mesh.nsd;
-	//int i, j, k, d, nint, noz, nox, noy, el, elz, elx, ely, j1, j2, i1, i2, k1, k2, nproc;
-	int i, j, d, nproc;
-	//int lnode[5], sizeofH, noz2, iroot;
-	//float *Have, *temp;
-
-	int *processors;
-
-	MPI_Comm world, horizon_p;
-	MPI_Group world_g, horizon_g;
-
-	processors = (int *)safe_malloc((E->parallel.nprocxy + 2) * sizeof(int));
-
-	/* determine which processors should get the message from me for 
-	 * computing the layer averages */
-
-	nproc = 0;
-	for(j = 0; j < E->parallel.nprocy; j++)
-		for(i = 0; i < E->parallel.nprocx; i++)
-		{
-			d = E->parallel.me_loc[3] + i * E->parallel.nprocz + j * E->parallel.nprocxz;
-			processors[nproc] = d;
-			nproc++;
-		}
-
-	if(nproc > 1)
-	{
-		world = MPI_COMM_WORLD;
-		MPI_Comm_group(world, &world_g);
-		MPI_Group_incl(world_g, nproc, processors, &horizon_g);
-		MPI_Comm_create(world, horizon_g, &horizon_p);
-
-		MPI_Allreduce(X, H, nn, MPI_FLOAT, MPI_SUM, horizon_p);
-
-		MPI_Comm_free(&horizon_p);
-		MPI_Group_free(&horizon_g);
-		MPI_Group_free(&world_g);
+	int i;
 
-	}
+	if(E->parallel.nprocxy > 1)
+		MPI_Allreduce(X, H, nn, MPI_FLOAT, MPI_SUM, horiz_comm);
 	else
 		for(i = 0; i < nn; i++)
 			H[i] = X[i];
 
-	free((void *)processors);
-
 	return;
 }
 
 
 void return_horiz_ave(struct All_variables *E, float *X, float *H)
 {
-	//const int dims = E->mesh.nsd;
-	//int i, j, k, d, nint, noz, nox, noy, el, elz, elx, ely, j1, j2, i1, i2, k1, k2, nproc;
-	int i, j, k, d, nint, noz, nox, noy, el, elz, elx, ely, nproc;
-	//int lnode[5], sizeofH, noz2, iroot;
-	int lnode[5], noz2;
-//	float *Have,*temp;
-	double *Have, *temp;
-	struct Shape_function1 M;
-	struct Shape_function1_dA dGamma;
-
-	int *processors;
-
-	MPI_Comm world, horizon_p;
-	MPI_Group world_g, horizon_g;
+	return_horiz_ave_fields(E, &X, &H, 1);
 
+	return;
+}
 
-	processors = (int *)safe_malloc((E->parallel.nprocxy + 2) * sizeof(int));
-//  Have = (float *)malloc((2*E->lmesh.noz+2)*sizeof(float));
-//  temp = (float *)malloc((2*E->lmesh.noz+2)*sizeof(float));
-	Have = (double *)safe_malloc((2 * E->lmesh.noz + 2) * sizeof(double));
-	temp = (double *)safe_malloc((2 * E->lmesh.noz + 2) * sizeof(double));
+/* horizontal averages of nf nodal fields X[f] into H[f], with one
+ * reduction over the layer for all of them */
+void return_horiz_ave_fields(struct All_variables *E, float **X, float **H, int nf)
+{
+	int i, j, k, d, f, nint, noz, nox, el, elz, elx, ely, size, wt;
+	int lnode[5];
+	double *Have, *temp, w;
+	struct Shape_function1 M;
+	struct Shape_function1_dA dGamma;
 
 	noz = E->lmesh.noz;
-	noy = E->lmesh.noy;
 	nox = E->lmesh.nox;
 	elz = E->lmesh.elz;
 	elx = E->lmesh.elx;
 	ely = E->lmesh.ely;
-	noz2 = 2 * noz;
+
+	/* field f in temp[f * (noz + 1) + i], the weights after them */
+	size = (nf + 1) * (noz + 1);
+	wt = nf * (noz + 1);
+	Have = (double *)safe_malloc((size + 1) * sizeof(double));
+	temp = (double *)safe_malloc((size + 1) * sizeof(double));
+
+	for(i = 0; i < size; i++)
+		temp[i] = 0.0;
 
 	for(i = 1; i <= elz; i++)
 	{
-		temp[i] = temp[i + noz] = 0.0;
-		temp[i + 1] = temp[i + 1 + noz] = 0.0;
 		for(j = 1; j <= elx; j++)
 			for(k = 1; k <= ely; k++)
 			{
@@ -180,8 +162,10 @@ void return_horiz_ave(struct All_variables *E, float *X, float *H)
 				for(d = 1; d <= onedvpoints[E->mesh.nsd]; d++)
 					for(nint = 1; nint <= onedvpoints[E->mesh.nsd]; nint++)
 					{
-						temp[i] += X[lnode[d]] * E->M.vpt[GMVINDEX(d, nint)] * dGamma.vpt[GMVGAMMA(0, nint)];
-						temp[i + noz] += E->M.vpt[GMVINDEX(d, nint)] * dGamma.vpt[GMVGAMMA(0, nint)];
+						w = E->M.vpt[GMVINDEX(d, nint)] * dGamma.vpt[GMVGAMMA(0, nint)];
+						for(f = 0; f < nf; f++)
+							temp[f * (noz + 1) + i] += X[f][lnode[d]] * E->M.vpt[GMVINDEX(d, nint)] * dGamma.vpt[GMVGAMMA(0, nint)];
+						temp[wt + i] += w;
 					}
 
 				if(i == elz)
@@ -194,8 +178,10 @@ void return_horiz_ave(struct All_variables *E, float *X, float *H)
 					for(d = 1; d <= onedvpoints[E->mesh.nsd]; d++)
 						for(nint = 1; nint <= onedvpoints[E->mesh.nsd]; nint++)
 						{
-							temp[i + 1] += X[lnode[d]] * E->M.vpt[GMVINDEX(d, nint)] * dGamma.vpt[GMVGAMMA(0, nint)];
-							temp[i + 1 + noz] += E->M.vpt[GMVINDEX(d, nint)] * dGamma.vpt[GMVGAMMA(0, nint)];
+							w = E->M.vpt[GMVINDEX(d, nint)] * dGamma.vpt[GMVGAMMA(0, nint)];
+							for(f = 0; f < nf; f++)
+								temp[f * (noz + 1) + i + 1] += X[f][lnode[d]] * E->M.vpt[GMVINDEX(d, nint)] * dGamma.vpt[GMVGAMMA(0, nint)];
+							temp[wt + i + 1] += w;
 						}
 				}
 
@@ -203,49 +189,21 @@ void return_horiz_ave(struct All_variables *E, float *X, float *H)
 
 	}							/* Done for i */
 
-
-	/* determine which processors should get the message from me for 
-	 * computing the layer averages */
-
-	nproc = 0;
-	for(j = 0; j < E->parallel.nprocy; j++)
-		for(i = 0; i < E->parallel.nprocx; i++)
-		{
-			d = E->parallel.me_loc[3] + i * E->parallel.nprocz + j * E->parallel.nprocxz;
-			processors[nproc] = d;
-			nproc++;
-		}
-
-	if(nproc > 1)
-	{
-		world = MPI_COMM_WORLD;
-		MPI_Comm_group(world, &world_g);
-		MPI_Group_incl(world_g, nproc, processors, &horizon_g);
-		MPI_Comm_create(world, horizon_g, &horizon_p);
-
-//    MPI_Allreduce(temp,Have,noz2+1,MPI_FLOAT,MPI_SUM,horizon_p);
-		MPI_Allreduce(temp, Have, noz2 + 1, MPI_DOUBLE, MPI_SUM, horizon_p);
-
-		MPI_Comm_free(&horizon_p);
-		MPI_Group_free(&horizon_g);
-		MPI_Group_free(&world_g);
-
-	}
+	if(E->parallel.nprocxy > 1)
+		MPI_Allreduce(temp, Have, size, MPI_DOUBLE, MPI_SUM, horiz_comm);
 	else
-		for(i = 1; i <= noz2; i++)
-		{
+		for(i = 0; i < size; i++)
 			Have[i] = temp[i];
-		}
 
-	for(i = 1; i <= noz; i++)
-	{
-		if(Have[i + noz] != 0.0)
-			H[i] = Have[i] / Have[i + noz];
-	}
+	for(f = 0; f < nf; f++)
+		for(i = 1; i <= noz; i++)
+		{
+			if(Have[wt + i] != 0.0)
+				H[f][i] = Have[f * (noz + 1) + i] / Have[wt + i];
+		}
 
 	free((void *)Have);
 	free((void *)temp);
-	free((void *)processors);
 
 	return;
 }
@@ -336,10 +294,13 @@ double global_div_norm2(struct All_variables *E,  double *A)
 
 
 
-double global_vdot(struct All_variables *E, double *A, double *B, int lev)
+/* this processor's share of global_vdot and global_pdot, so that
+ * independent dot products can be reduced together by global_sums */
+
+double local_vdot(struct All_variables *E, double *A, double *B, int lev)
 {
 	int i, neq;
-	double prod, temp;
+	double temp;
 
 	neq = E->lmesh.NEQ[lev];
 
@@ -350,17 +311,14 @@ double global_vdot(struct All_variables *E, double *A, double *B, int lev)
 			temp += A[i] * B[i];
 	}
 
-	MPI_Allreduce(&temp, &prod, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
-
-	return (prod);
+	return (temp);
 }
 
 
-double global_pdot(struct All_variables *E, double *A, double *B, int lev)
-
+double local_pdot(struct All_variables *E, double *A, double *B, int lev)
 {
 	int i, npno;
-	double prod, temp;
+	double temp;
 
 	npno = E->lmesh.NPNO[lev];
 
@@ -368,6 +326,40 @@ double global_pdot(struct All_variables *E, double *A, double *B, int lev)
 	for(i = 1; i <= npno; i++)
 		temp += A[i] * B[i];
 
+	return (temp);
+}
+
+
+void global_sums(struct All_variables *E, double *A, int n)
+{
+	if(E->parallel.nproc == 1)
+		return;
+
+	MPI_Allreduce(MPI_IN_PLACE, A, n, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+	return;
+}
+
+
+double global_vdot(struct All_variables *E, double *A, double *B, int lev)
+{
+	double prod, temp;
+
+	temp = local_vdot(E, A, B, lev);
+
+	MPI_Allreduce(&temp, &prod, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+	return (prod);
+}
+
+
+double global_pdot(struct All_variables *E, double *A, double *B, int lev)
+
+{
+	double prod, temp;
+
+	temp = local_pdot(E, A, B, lev);
+
 	MPI_Allreduce(&temp, &prod, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
 
 	return (prod);
@@ -423,37 +415,15 @@ float global_fmax(struct All_variables *E, float a)
 /* ================================================== */
 void sum_across_depth_sph1(struct All_variables *E, float *sphc, float *sphs)
 {
-	int jumpp, total, j, d;
+	int jumpp, total, j;
 
 	static float *sphcs, *temp;
 	static int been_here = 0;
-	static int *processors, nproc;
-
-	static MPI_Comm world, horizon_p;
-	static MPI_Group world_g, horizon_g;
 
 	if(been_here == 0)
 	{
-		processors = (int *)safe_malloc((E->parallel.nprocz + 2) * sizeof(int));
 		temp = (float *)safe_malloc((E->sphere.hindice * 2 + 3) * sizeof(float));
 		sphcs = (float *)safe_malloc((E->sphere.hindice * 2 + 3) * sizeof(float));
-
-		nproc = 0;
-		for(j = 0; j < E->parallel.nprocz; j++)
-		{
-			d = E->parallel.me_sph * E->parallel.nprocz + E->parallel.nprocz - 1 - j;
-			processors[nproc] = d;
-			nproc++;
-		}
-
-		if(nproc > 0)
-		{
-			world = MPI_COMM_WORLD;
-			MPI_Comm_group(world, &world_g);
-			MPI_Group_incl(world_g, nproc, processors, &horizon_g);
-			MPI_Comm_create(world, horizon_g, &horizon_p);
-		}
-
 		been_here++;
 	}
 
@@ -465,17 +435,12 @@ void sum_across_depth_sph1(struct All_variables *E, float *sphc, float *sphs)
 		sphcs[j + jumpp] = sphs[j];
 	}
 
-	if(nproc > 0)
-	{
-
-		MPI_Allreduce(sphcs, temp, total, MPI_FLOAT, MPI_SUM, horizon_p);
-
-		for(j = 0; j < E->sphere.hindice; j++)
-		{
-			sphc[j] = temp[j];
-			sphs[j] = temp[j + jumpp];
-		}
+	MPI_Allreduce(sphcs, temp, total, MPI_FLOAT, MPI_SUM, vert_comm);
 
+	for(j = 0; j < E->sphere.hindice; j++)
+	{
+		sphc[j] = temp[j];
+		sphs[j] = temp[j + jumpp];
 	}
 
 	return;
@@ -484,88 +449,36 @@ void sum_across_depth_sph1(struct All_variables *E, float *sphc, float *sphs)
 /* ================================================== */
 void sum_across_surface(struct All_variables *E, float *data, int total)
 {
-	int j, d;
+	int j;
 	float *temp;
-	static int been_here = 0;
-	static int *processors, nproc;
-
-	static MPI_Comm world, horizon_p;
-	static MPI_Group world_g, horizon_g;
-
-	if(been_here == 0)
-	{
-		processors = (int *)safe_malloc((E->parallel.nprocxy + 2) * sizeof(int));
-
-		nproc = 0;
-		for(j = 0; j < E->parallel.nprocxy; j++)
-		{
-			d = E->parallel.me_loc[3] + j * E->parallel.nprocz;
-			processors[nproc] = d;
-			nproc++;
-		}
 
-		if(nproc > 0)
-		{
-			world = MPI_COMM_WORLD;
-			MPI_Comm_group(world, &world_g);
-			MPI_Group_incl(world_g, nproc, processors, &horizon_g);
-			MPI_Comm_create(world, horizon_g, &horizon_p);
-		}
+	if(E->parallel.nprocxy == 1)
+		return;
 
-		been_here++;
-	}
+	temp = (float *)safe_malloc((total + 1) * sizeof(float));
+	MPI_Allreduce(data, temp, total, MPI_FLOAT, MPI_SUM, horiz_comm);
 
-	if(nproc > 0)
+	for(j = 0; j < total; j++)
 	{
-
-		temp = (float *)safe_malloc((total + 1) * sizeof(float));
-		MPI_Allreduce(data, temp, total, MPI_FLOAT, MPI_SUM, horizon_p);
-
-		for(j = 0; j < total; j++)
-		{
-			data[j] = temp[j];
-		}
-
-		free((void *)temp);
-
+		data[j] = temp[j];
 	}
 
+	free((void *)temp);
+
 	return;
 }
 
 /* ================================================== */
 void sum_across_surf_sph1(struct All_variables *E, float *sphc, float *sphs)
 {
-	int jumpp, total, j, d;
+	int jumpp, total, j;
 	static float *sphcs, *temp;
 	static int been_here = 0;
-	static int *processors, nproc;
-
-	static MPI_Comm world, horizon_p;
-	static MPI_Group world_g, horizon_g;
 
 	if(been_here == 0)
 	{
-		processors = (int *)safe_malloc((E->parallel.nprocxy + 2) * sizeof(int));
 		temp = (float *)safe_malloc((E->sphere.hindice * 2 + 3) * sizeof(float));
 		sphcs = (float *)safe_malloc((E->sphere.hindice * 2 + 3) * sizeof(float));
-
-		nproc = 0;
-		for(j = 0; j < E->parallel.nprocxy; j++)
-		{
-			d = E->parallel.me_loc[3] + j * E->parallel.nprocz;
-			processors[nproc] = d;
-			nproc++;
-		}
-
-		if(nproc > 0)
-		{
-			world = MPI_COMM_WORLD;
-			MPI_Comm_group(world, &world_g);
-			MPI_Group_incl(world_g, nproc, processors, &horizon_g);
-			MPI_Comm_create(world, horizon_g, &horizon_p);
-		}
-
 		been_here++;
 	}
 
@@ -577,90 +490,67 @@ void sum_across_surf_sph1(struct All_variables *E, float *sphc, float *sphs)
 		sphcs[j + jumpp] = sphs[j];
 	}
 
-	if(nproc > 0)
+	MPI_Allreduce(sphcs, temp, total, MPI_FLOAT, MPI_SUM, horiz_comm);
+
+	for(j = 0; j < E->sphere.hindice; j++)
 	{
+		sphc[j] = temp[j];
+		sphs[j] = temp[j + jumpp];
+	}
 
-		MPI_Allreduce(sphcs, temp, total, MPI_FLOAT, MPI_SUM, horizon_p);
+	return;
+}
 
-		for(j = 0; j < E->sphere.hindice; j++)
-		{
-			sphc[j] = temp[j];
-			sphs[j] = temp[j + jumpp];
-		}
+/* ==========================================================
+   Each processor of a layer fills its own part of the surface
+   array TG and leaves the rest zero. The combining rule keeps
+   an entry that is already set and fills it from the other
+   operand otherwise; it is applied in rank order so every
+   processor ends up with the same TG.
+   ==========================================================  */
+static void fill_unset_entries(void *in, void *inout, int *len, MPI_Datatype *type)
+{
+	int j;
+	float *a = (float *)in;
+	float *b = (float *)inout;
+	const float e_16 = 1.e-16;
 
+	(void)type;
+
+	for(j = 0; j < *len; j++)
+	{
+		if(fabs(a[j]) < e_16)
+			b[j] += a[j];
+		else
+			b[j] = a[j];
 	}
 
 	return;
 }
 
-/* ==========================================================  */
 void gather_TG_to_me0(struct All_variables *E, float *TG)
 {
-	int i, j, nsl, idb, ii, to_everyone, from_proc, mst, me;
+	int j, nsl;
 
-	static float *RG[20];
+	static float *RG;
+	static MPI_Op fill_op;
 	static int been_here = 0;
-	const float e_16 = 1.e-16;
-
-	MPI_Status status[100];
-	//MPI_Status status1;
-	MPI_Request request[100];
 
 	if(E->parallel.nprocxy == 1)
 		return;
 
 	nsl = E->sphere.nsf + 1;
-	me = E->parallel.me;
 	if(been_here == 0)
 	{
 		been_here++;
-		for(i = 1; i < E->parallel.nprocxy; i++)
-		{
-			RG[i] = (float *)safe_malloc((E->sphere.nsf + 1) * sizeof(float));
-			RG[i][0] = 0.0;
-		}
-	}
-
-
-	idb = 0;
-	for(i = 1; i <= E->parallel.nprocxy; i++)
-	{
-		to_everyone = E->parallel.nprocz * (i - 1) + E->parallel.me_loc[3];
-
-		if(me != to_everyone)
-		{						/* send TG */
-			idb++;
-			mst = me;
-			MPI_Isend(TG, nsl, MPI_FLOAT, to_everyone, mst, MPI_COMM_WORLD, &request[idb - 1]);
-		}
-	}
-
-
-/* parallel_process_sync(); */
-
-	ii = 0;
-	for(i = 1; i <= E->parallel.nprocxy; i++)
-	{
-		from_proc = E->parallel.nprocz * (i - 1) + E->parallel.me_loc[3];
-		if(me != from_proc)
-		{						/* me==0 receive all TG and add them up */
-			mst = from_proc;
-			idb++;
-			ii++;
-			MPI_Irecv(RG[ii], nsl, MPI_FLOAT, from_proc, mst, MPI_COMM_WORLD, &request[idb - 1]);
-		}
+		RG = (float *)safe_malloc(nsl * sizeof(float));
+		MPI_Op_create(fill_unset_entries, 0, &fill_op);
 	}
 
-	MPI_Waitall(idb, request, status);
-
-	for(i = 1; i < E->parallel.nprocxy; i++)
-		for(j = 1; j <= E->sphere.nsf; j++)
-		{
-			if(fabs(TG[j]) < e_16)
-				TG[j] += RG[i][j];
-		}
+	MPI_Allreduce(TG, RG, nsl, MPI_FLOAT, fill_op, horiz_comm);
 
-/* parallel_process_sync(); */
+	for(j = 1; j <= E->sphere.nsf; j++)
+		TG[j] = RG[j];
 
 	return;
 }
@@ -669,72 +559,36 @@ void gather_TG_to_me0(struct All_variables *E, float *TG)
 /* ==========================================================  */
 void propogator_down_process(struct All_variables *E, float *Tadi)
 {
-	//int i, j, noz, idb, ii, to_proc, from_proc, mst, me;
-	int i, j, noz, idb, to_proc, from_proc, mst, me;
-	float temp;
+	int i, j, noz, from_proc;
+	float temp, SD[2];
 
-	static float *RG[20], *SD;
+	static float *RG;
 	static int been_here = 0;
-	//const float e_16 = 1.e-16;
-
-	MPI_Status status[100];
-	//MPI_Status status1;
-	MPI_Request request[100];
 
 	if(E->parallel.nprocz == 1)
 		return;
 
 	noz = E->lmesh.noz;
-	me = E->parallel.me;
 	if(been_here == 0)
 	{
 		been_here++;
-		for(i = 0; i < E->parallel.nprocz; i++)
-		{
-			RG[i] = (float *)safe_malloc((4) * sizeof(float));
-			RG[i][0] = 0.0;
-		}
-		SD = (float *)safe_malloc((4) * sizeof(float));
-		SD[0] = 0.0;
+		RG = (float *)safe_malloc((2 * E->parallel.nprocz + 2) * sizeof(float));
 	}
 
-	SD[1] = Tadi[1];
-	SD[2] = Tadi[noz];
-
-	idb = 0;
-	for(i = E->parallel.nprocz - 1; i >= 0; i--)
-	{
-		to_proc = i + E->parallel.me_loc[1] * E->parallel.nprocz + E->parallel.me_loc[2] * E->parallel.nprocz * E->parallel.nprocx;
-		if(to_proc != me)
-		{
-			idb++;
-			mst = (1 + me) * (to_proc + 1);
-			MPI_Isend(SD, 3, MPI_FLOAT, to_proc, mst, MPI_COMM_WORLD, &request[idb - 1]);
-		}
-	}
-
-	for(i = E->parallel.nprocz - 1; i >= 0; i--)
-	{
-		from_proc = i + E->parallel.me_loc[1] * E->parallel.nprocz + E->parallel.me_loc[2] * E->parallel.nprocz * E->parallel.nprocx;
-		if(from_proc != me)
-		{
-			idb++;
-			mst = (1 + me) * (from_proc + 1);
-			j = from_proc % E->parallel.nprocz;
-			MPI_Irecv(RG[j], 3, MPI_FLOAT, from_proc, mst, MPI_COMM_WORLD, &request[idb - 1]);
-		}
-	}
-
-	MPI_Waitall(idb, request, status);
+	/* top and bottom value of every processor in my column, in
+	 * column rank (me_loc[3]) order */
+	SD[0] = Tadi[1];
+	SD[1] = Tadi[noz];
+	MPI_Allgather(SD, 2, MPI_FLOAT, RG, 2, MPI_FLOAT, vert_comm);
 
 	temp = 0;
 	for(i = E->parallel.nprocz - 1 - E->parallel.me_loc[3]; i > 0; i--)
 	{
 		from_proc = E->parallel.me + i;
 		j = from_proc % E->parallel.nprocz;
-		temp = temp + RG[j][1];
+		temp = temp + RG[2 * j];
 		if(j == E->parallel.nprocz - 1)
-			E->data.T_adi0 = RG[j][2];
+			E->data.T_adi0 = RG[2 * j + 1];
 	}
 
 	for(j = 1; j <= noz; j++)
@@ -751,7 +605,7 @@ void propogator_down_process(struct All_variables *E, float *Tadi)
 			from_proc = E->parallel.me - i;
 			j = from_proc % E->parallel.nprocz;
 			if(j < E->parallel.me_loc[3])
-				E->data.T_adi1 += RG[j][1];
+				E->data.T_adi1 += RG[2 * j];
 		}
 		E->data.T_adi1 += Tadi[1];
 	}
@@ -762,34 +616,12 @@ void propogator_down_process(struct All_variables *E, float *Tadi)
 /* ================================================== */
 double sum_across_depth(struct All_variables *E, double temp1)
 {
-	int j, d;
 	double temp2;
-	static int been_here = 0;
-	static int *processors, nproc;
 
-	static MPI_Comm world, vert_p;
-	static MPI_Group world_g, vert_g;
-
-	if(been_here == 0)
-	{
-		processors = (int *)safe_malloc((E->parallel.nprocz + 2) * sizeof(int));
-
-		for(j = 0; j < E->parallel.nprocz; j++)
-		{
-			d = j + E->parallel.me_loc[1] * E->parallel.nprocz + E->parallel.me_loc[2] * E->parallel.nprocxz;
-			processors[j] = d;
-		}
-
-		nproc = E->parallel.nprocz;
-		world = MPI_COMM_WORLD;
-		MPI_Comm_group(world, &world_g);
-		MPI_Group_incl(world_g, nproc, processors, &vert_g);
-		MPI_Comm_create(world, vert_g, &vert_p);
-
-		been_here++;
-	}
+	if(E->parallel.nprocz == 1)
+		return (temp1);
 
-	MPI_Allreduce(&temp1, &temp2, 1, MPI_DOUBLE, MPI_SUM, vert_p);
+	MPI_Allreduce(&temp1, &temp2, 1, MPI_DOUBLE, MPI_SUM, vert_comm);
 
 	return (temp2);
 }
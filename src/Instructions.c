@@ -46,6 +46,9 @@
 #include <string.h>
 #include "element_definitions.h"
 #include "global_defs.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #ifdef USE_GGRD
 #include "hc.h"
 #endif
@@ -90,6 +93,7 @@ void read_instructions(struct All_variables *E, int argc, char **argv)
 	force_report(E,"ok4");
 
 	parallel_domain_decomp1(E);
+	setup_layer_comms(E);
 	force_report(E,"ok5");
 
 	allocate_common_vars(E);
@@ -134,6 +138,9 @@ void read_instructions(struct All_variables *E, int argc, char **argv)
 
 	mass_matrix(E);
 	force_report(E,"ok15b");
+
+	if(E->control.elt_k_cache)
+		construct_elt_k_tensors(E);
 	
 
 	//assign_surface_rayleigh(E); /* this has a proc wait loop in it  */
@@ -278,6 +285,7 @@ void allocate_common_vars(struct All_variables *E)
 
 		E->BI[i] = (double *)safe_malloc((E->lmesh.NEQ[i] + 2) * sizeof(double));
 		E->BPI[i] = (double *)safe_malloc((E->lmesh.NPNO[i] + 1) * sizeof(double));
+		E->BPM[i] = (double *)safe_malloc((E->lmesh.NPNO[i] + 1) * sizeof(double));
 		E->control.B_is_good[i] = 0;
 	}
 #ifdef CITCOM_ALLOW_ANISOTROPIC_VISC
@@ -837,6 +845,23 @@ void read_initial_settings(struct All_variables *E)
 	input_int("freeze_surface_at_step",&(E->control.freeze_surface_at_step),"-9999999",m);
 
 	input_boolean("node_assemble", &(E->control.NASSEMBLE), "off", m);
+	input_boolean("node_gather", &(E->control.node_gather), "off", m);
+	input_boolean("overlap_exchange", &(E->control.overlap_exchange), "off", m);
+	if(E->control.overlap_exchange && 3 != E->mesh.nsd)
+	{
+		if(E->parallel.me == 0)
+			fprintf(stderr, "overlap_exchange needs a 3D mesh, switched off\n");
+		E->control.overlap_exchange = 0;
+	}
+	input_boolean("block_storage", &(E->control.block_storage), "off", m);
+	input_boolean("stencil_storage", &(E->control.stencil_storage), "off", m);
+	if(E->control.stencil_storage)
+		E->control.block_storage = 0;
+	input_int("omp_threads", &(E->control.omp_threads), "0,0,nomax", m);
+#ifdef _OPENMP
+	if(E->control.omp_threads > 0)
+		omp_set_num_threads(E->control.omp_threads);
+#endif
 	/* general mesh structure */
 
 	input_boolean("parallel_auto", &(E->parallel.automa), "off", m);
@@ -1046,8 +1071,30 @@ void read_initial_settings(struct All_variables *E)
 	input_boolean("precond", &(E->control.precondition), "off", m);
 	input_boolean("vprecond", &(E->control.vprecondition), "on", m);
 	input_int("mg_cycle", &(E->control.mg_cycle), "2,0,nomax", m);
+	input_boolean("mg_fcg", &(E->control.mg_fcg), "off", m);
+	input_int("mg_fcg_iterations", &(E->control.mg_fcg_iterations), "100,1,nomax", m);
 	input_int("down_heavy", &(E->control.down_heavy), "1,0,nomax", m);
 	input_int("up_heavy", &(E->control.up_heavy), "1,0,nomax", m);
+	input_string("mg_smoother", E->control.SMOOTHER_TYPE, "gauss_seidel", m);
+	if(strcmp(E->control.SMOOTHER_TYPE, "colour_gs") == 0)
+		E->control.mg_smoother = SMOOTH_COLOUR_GS;
+	else if(strcmp(E->control.SMOOTHER_TYPE, "chebyshev") == 0)
+		E->control.mg_smoother = SMOOTH_CHEBYSHEV;
+	else
+		E->control.mg_smoother = SMOOTH_GS;
+	input_int("zline_levels", &(E->control.zline_levels), "0,0,nomax", m);
+	if(E->control.zline_levels && 3 != E->mesh.nsd)
+	{
+		if(E->parallel.me == 0)
+			fprintf(stderr, "zline_levels needs a 3D mesh, switched off\n");
+		E->control.zline_levels = 0;
+	}
+	input_float("cheb_eig_ratio", &(E->control.cheb_eig_ratio), "30.0,1.0,nomax", m);
+	input_int("cheb_power_its", &(E->control.cheb_power_its), "10,1,nomax", m);
+	input_boolean("coarse_direct", &(E->control.coarse_direct), "off", m);
+	input_int("coarse_direct_max", &(E->control.coarse_direct_max), "3000,1,nomax", m);
+	if(E->mesh.periodic_x || E->mesh.periodic_y)
+		E->control.coarse_direct = 0;
 	input_double("accuracy", &(E->control.accuracy), "1.0e-4,0.0,1.0", m);
 	input_int("viterations", &(E->control.max_vel_iterations), "250,0,nomax", m);
 
@@ -1056,6 +1103,23 @@ void read_initial_settings(struct All_variables *E)
 	input_int("vlowstep", &(E->control.v_steps_low), "250,0,nomax", m);
 	input_int("vupperstep", &(E->control.v_steps_upper), "1,0,nomax", m);
 	input_int("piterations", &(E->control.p_iterations), "100,0,nomax", m);
+	input_boolean("stokes_fgmres", &(E->control.stokes_fgmres), "off", m);
+	input_int("stokes_restart", &(E->control.stokes_restart), "30,1,nomax", m);
+	input_int("stokes_extrapolate", &(E->control.stokes_extrapolate), "0,0,2", m);
+	input_boolean("uzawa_ew", &(E->control.uzawa_ew), "off", m);
+	input_float("ew_gamma", &(E->control.ew_gamma), "0.9,0.0,1.0", m);
+	input_float("ew_max", &(E->control.ew_max), "10.0,1.0,nomax", m);
+	if(!E->control.NMULTIGRID)
+		E->control.stokes_fgmres = 0;
+	input_string("schur_precond", E->control.SCHUR_TYPE, "bpi", m);
+	if(strcmp(E->control.SCHUR_TYPE, "visc_mass") == 0)
+		E->control.schur_precond = SCHUR_VISC_MASS;
+	else if(strcmp(E->control.SCHUR_TYPE, "bfbt") == 0)
+		E->control.schur_precond = SCHUR_BFBT;
+	else
+		E->control.schur_precond = SCHUR_BPI;
+	input_double("bfbt_accuracy", &(E->control.bfbt_accuracy), "1.0e-4,0.0,1.0", m);
+	input_int("bfbt_iterations", &(E->control.bfbt_iterations), "100,1,nomax", m);
 	input_int("maxsamevisc", &(E->control.max_same_visc), "25,0,nomax", m);
 
 	/* data section */
@@ -1116,6 +1180,50 @@ void read_initial_settings(struct All_variables *E)
 	/* e.g. convection settings here */
 	(E->problem_settings) (E);
 	viscosity_parameters(E);
+
+	input_boolean("matrix_free", &(E->control.matrix_free), "off", m);
+	if(E->control.matrix_free && !(E->control.CART3D && E->control.NMULTIGRID))
+	{
+		if(E->parallel.me == 0)
+			fprintf(stderr, "matrix_free needs Geometry=cart3d and Solver=multigrid, switched off\n");
+		E->control.matrix_free = 0;
+	}
+#ifdef CITCOM_ALLOW_ANISOTROPIC_VISC
+	if(E->control.matrix_free && E->viscosity.allow_anisotropic_viscosity)
+	{
+		if(E->parallel.me == 0)
+			fprintf(stderr, "matrix_free is not implemented for anisotropic viscosity, switched off\n");
+		E->control.matrix_free = 0;
+	}
+#endif
+
+	input_float("stiffness_update_tol", &(E->control.stiffness_update_tol), "0.0,0.0,nomax", m);
+	input_int("stiffness_full_every", &(E->control.stiffness_full_every), "20,1,nomax", m);
+	input_boolean("galerkin_coarse", &(E->control.galerkin_coarse), "off", m);
+	if(E->control.galerkin_coarse && !(E->control.CART3D && E->control.NMULTIGRID))
+	{
+		if(E->parallel.me == 0)
+			fprintf(stderr, "galerkin_coarse needs Geometry=cart3d and Solver=multigrid, switched off\n");
+		E->control.galerkin_coarse = 0;
+	}
+	input_boolean("mg_visc_transfer", &(E->control.mg_visc_transfer), "off", m);
+	if(E->control.mg_visc_transfer && !(E->control.NMULTIGRID && 3 == E->mesh.nsd))
+	{
+		if(E->parallel.me == 0)
+			fprintf(stderr, "mg_visc_transfer needs Solver=multigrid in 3D, switched off\n");
+		E->control.mg_visc_transfer = 0;
+	}
+	input_boolean("elt_k_cache", &(E->control.elt_k_cache), "off", m);
+	input_int("elt_k_cache_max", &(E->control.elt_k_cache_max), "1000,1,nomax", m);
+	if(!E->control.CART3D)
+		E->control.elt_k_cache = 0;
+#ifdef CITCOM_ALLOW_ANISOTROPIC_VISC
+	if(E->viscosity.allow_anisotropic_viscosity)
+	{
+		E->control.stiffness_update_tol = 0.0;
+		E->control.elt_k_cache = 0;
+	}
+#endif
 	return;
 }
 
@@ -1178,186 +1178,402 @@ void exchange_markers(struct All_variables *E)
   exchange ID related information across boundaries
  ============================================ */
 
-void exchange_id_d20(struct All_variables *E, double *U, int lev)
+/* ==========================================================
+   Halo exchange set up once per level. The EXCHANGE_ID and
+   EXCHANGE_NODE lists are copied into contiguous index arrays
+   and every message of a dimension becomes a persistent
+   request (MPI_Send_init/MPI_Recv_init) bound to the fixed
+   pack buffers, so a call only packs, starts, waits and adds.
+   The dimensions still go one after the other: the edge and
+   corner sums reach the diagonal neighbours through the
+   second and third pass.
+   ========================================================== */
+
+struct HALO_PASS
 {
-	//int target_proc, kk, e, node, i, ii, j, k, bound, type, idb, msginfo[8];
-	int target_proc, kk, i, j, k, idb;
-	static double *S[27], *R[27];
+	int num[4][3];				/* entries per dimension and side */
+	int *idx[4][3];				/* equation or node of each entry */
+	int self[4][3];				/* periodic onto itself, no message */
+	int nreq[4];
+	MPI_Request req[4][4];		/* sends then receives, per dimension */
+};
+
+static struct HALO_PASS halo_id[MAX_LEVELS], halo_node[MAX_LEVELS];
+
+static void init_halo_pass(struct All_variables *E, struct HALO_PASS *H, int lev, int nodes, void *S[3], void *R[3], MPI_Datatype type)
+{
+	int i, j, k, target_proc;
+
+	const int levmax = E->mesh.levmax;
+
+	for(i = 1; i <= E->mesh.nsd; i++)
+	{
+		H->nreq[i] = 0;
+		for(k = 1; k <= 2; k++)
+		{
+			H->num[i][k] = 0;
+			H->self[i][k] = 0;
+			if(!E->parallel.NUM_PASS[levmax].bound[i][k])
+				continue;
+
+			H->num[i][k] = nodes ? E->parallel.NUM_NODE[lev].pass[i][k] : E->parallel.NUM_NEQ[lev].pass[i][k];
+			H->idx[i][k] = (int *)safe_malloc((H->num[i][k] + 1) * sizeof(int));
+			for(j = 1; j <= H->num[i][k]; j++)
+				H->idx[i][k][j - 1] = nodes ? E->parallel.EXCHANGE_NODE[lev][j].pass[i][k] : E->parallel.EXCHANGE_ID[lev][j].pass[i][k];
+
+			target_proc = E->parallel.PROCESSOR[lev].pass[i][k];
+			H->self[i][k] = (target_proc == E->parallel.me);
+		}
+
+		for(k = 1; k <= 2; k++)
+			if(E->parallel.NUM_PASS[levmax].bound[i][k] && !H->self[i][k])
+				MPI_Send_init(S[k], H->num[i][k], type, E->parallel.PROCESSOR[lev].pass[i][k], 1, MPI_COMM_WORLD, &H->req[i][H->nreq[i]++]);
+		for(k = 1; k <= 2; k++)
+			if(E->parallel.NUM_PASS[levmax].bound[i][k] && !H->self[i][k])
+				MPI_Recv_init(R[k], H->num[i][k], type, E->parallel.PROCESSOR[lev].pass[i][k], 1, MPI_COMM_WORLD, &H->req[i][H->nreq[i]++]);
+	}
+
+	return;
+}
+
+
+/* exchange_id_d20 is split so that the caller can work while the
+ * messages are in flight: exchange_id_d20_begin packs and starts the
+ * first dimension, exchange_id_d20_progress moves on to the next one
+ * whenever the current one has arrived, and exchange_id_d20_end
+ * completes what is left. Only one of these can be open at a time. */
+
+static double *halo_id_S[3], *halo_id_R[3];
+static float *halo_node_S[3], *halo_node_R[3];
+static int halo_id_max, halo_node_max;	/* longest pass, in entries */
+static double *halo_id_U;
+static int halo_id_lev, halo_id_dim;
+
+static void halo_setup(struct All_variables *E)
+{
+	int i, k, l;
+	void *s[3], *r[3];
 
 	static int been_here = 0;
-	//static int mid_recv, sizeofk;
-	static int sizeofk;
 	const int levmax = E->mesh.levmax;
 
-	MPI_Status status[CU_MPI_MSG_LIM];
-	MPI_Request request[CU_MPI_MSG_LIM];
+	if(been_here)
+		return;
 
-	if(been_here == 0)
-	{
-		sizeofk = 0;
-		for(i = 1; i <= E->mesh.nsd; i++)
-			for(k = 1; k <= 2; k++)
+	halo_id_max = halo_node_max = 0;
+	for(i = 1; i <= E->mesh.nsd; i++)
+		for(k = 1; k <= 2; k++)
+			if(E->parallel.NUM_PASS[levmax].bound[i][k])
 			{
-				if(E->parallel.NUM_PASS[levmax].bound[i][k])
-					sizeofk = max(sizeofk, (1 + E->parallel.NUM_NEQ[levmax].pass[i][k]) * sizeof(double));
+				halo_id_max = max(halo_id_max, 1 + E->parallel.NUM_NEQ[levmax].pass[i][k]);
+				halo_node_max = max(halo_node_max, 1 + E->parallel.NUM_NODE[levmax].pass[i][k]);
 			}
 
+	for(k = 1; k <= 2; k++)
+	{
+		halo_id_S[k] = (double *)safe_malloc(halo_id_max * sizeof(double));
+		halo_id_R[k] = (double *)safe_malloc(halo_id_max * sizeof(double));
+		s[k] = halo_id_S[k];
+		r[k] = halo_id_R[k];
+	}
+	for(l = E->mesh.levmin; l <= levmax; l++)
+		init_halo_pass(E, &halo_id[l], l, 0, s, r, MPI_DOUBLE);
+
+	for(k = 1; k <= 2; k++)
+	{
+		halo_node_S[k] = (float *)safe_malloc(halo_node_max * sizeof(float));
+		halo_node_R[k] = (float *)safe_malloc(halo_node_max * sizeof(float));
+		s[k] = halo_node_S[k];
+		r[k] = halo_node_R[k];
+	}
+	for(l = E->mesh.levmin; l <= levmax; l++)
+		init_halo_pass(E, &halo_node[l], l, 1, s, r, MPI_FLOAT);
+
+	been_here = 1;
+	return;
+}
+
+static void halo_id_start(void)
+{
+	int j, k, n;
+	int *idx;
+	double *B;
+	struct HALO_PASS *H = &halo_id[halo_id_lev];
+	const int i = halo_id_dim;
+
+	for(k = 1; k <= 2; k++)
+	{
+		n = H->num[i][k];
+		idx = H->idx[i][k];
+		B = halo_id_S[k];
+		for(j = 0; j < n; j++)
+			B[j] = halo_id_U[idx[j]];
+	}
+
+	MPI_Startall(H->nreq[i], H->req[i]);
+
+	return;
+}
+
+static void halo_id_finish(void)
+{
+	int j, k, n;
+	int *idx;
+	double *B;
+	struct HALO_PASS *H = &halo_id[halo_id_lev];
+	const int i = halo_id_dim;
+
+	for(k = 1; k <= 2; k++)
+	{
+		n = H->num[i][k];
+		idx = H->idx[i][k];
+		B = H->self[i][k] ? halo_id_S[3 - k] : halo_id_R[k];
+		for(j = 0; j < n; j++)
+			halo_id_U[idx[j]] += B[j];
+	}
+
+	return;
+}
+
+void exchange_id_d20_begin(struct All_variables *E, double *U, int lev)
+{
+	halo_setup(E);
+
+	halo_id_U = U;
+	halo_id_lev = lev;
+	halo_id_dim = 1;
+	halo_id_start();
+
+	return;
+}
+
+/* returns 1 once every dimension has been added in */
+int exchange_id_d20_progress(struct All_variables *E)
+{
+	int flag;
+	struct HALO_PASS *H = &halo_id[halo_id_lev];
+
+	while(halo_id_dim <= E->mesh.nsd)
+	{
+		MPI_Testall(H->nreq[halo_id_dim], H->req[halo_id_dim], &flag, MPI_STATUSES_IGNORE);
+		if(!flag)
+			return 0;
+		halo_id_finish();
+		if(++halo_id_dim <= E->mesh.nsd)
+			halo_id_start();
+	}
+
+	return 1;
+}
+
+void exchange_id_d20_end(struct All_variables *E)
+{
+	struct HALO_PASS *H = &halo_id[halo_id_lev];
+
+	while(halo_id_dim <= E->mesh.nsd)
+	{
+		MPI_Waitall(H->nreq[halo_id_dim], H->req[halo_id_dim], MPI_STATUSES_IGNORE);
+		halo_id_finish();
+		if(++halo_id_dim <= E->mesh.nsd)
+			halo_id_start();
+	}
+
+	return;
+}
+
+void exchange_id_d20(struct All_variables *E, double *U, int lev)
+{
+	exchange_id_d20_begin(E, U, lev);
+	exchange_id_d20_end(E);
+
+	return;
+}
+
+
+void exchange_node_f20(struct All_variables *E, float *U, int lev)
+{
+	int i, j, k, n;
+	int *idx;
+	float *B;
+	struct HALO_PASS *H;
+
+	halo_setup(E);
+	H = &halo_node[lev];
+
+	for(i = 1; i <= E->mesh.nsd; i++)
+	{
 		for(k = 1; k <= 2; k++)
 		{
-			S[k] = (double *)safe_malloc(sizeofk);
-			R[k] = (double *)safe_malloc(sizeofk);
+			n = H->num[i][k];
+			idx = H->idx[i][k];
+			B = halo_node_S[k];
+			for(j = 0; j < n; j++)
+				B[j] = U[idx[j]];
+		}
+
+		MPI_Startall(H->nreq[i], H->req[i]);
+		MPI_Waitall(H->nreq[i], H->req[i], MPI_STATUSES_IGNORE);
+
+		for(k = 1; k <= 2; k++)
+		{
+			n = H->num[i][k];
+			idx = H->idx[i][k];
+			B = H->self[i][k] ? halo_node_S[3 - k] : halo_node_R[k];
+			for(j = 0; j < n; j++)
+				U[idx[j]] += B[j];
+		}
+	}							/* for dim */
+
+	return;
+}
+
+
+/* ==========================================================
+   Several fields in one go: exchange_id_d20_fields and
+   exchange_node_f20_fields sum nf equation (double) or node
+   (float) arrays across the processor boundaries with one
+   message per neighbour and dimension instead of nf. The
+   fields are packed one after the other, and each entry is
+   summed in the same order as by the single field calls.
+   ========================================================== */
+
+void exchange_id_d20_fields(struct All_variables *E, double **U, int nf, int lev)
+{
+	int i, j, k, f, n, idb;
+	int *idx;
+	double *B;
+	static double *S[3], *R[3];
+	static int size = 0;
+	MPI_Request request[4];
+	struct HALO_PASS *H;
+
+	const int levmax = E->mesh.levmax;
+
+	halo_setup(E);
+	H = &halo_id[lev];
+
+	if(nf * halo_id_max > size)
+	{
+		size = nf * halo_id_max;
+		for(k = 1; k <= 2; k++)
+		{
+			/* old contents are not needed, only the larger size */
+			free((void *)S[k]);
+			free((void *)R[k]);
+			S[k] = (double *)safe_malloc(size * sizeof(double));
+			R[k] = (double *)safe_malloc(size * sizeof(double));
 		}
-		been_here++;
 	}
 
 	for(i = 1; i <= E->mesh.nsd; i++)
 	{
-
 		idb = 0;
 		for(k = 1; k <= 2; k++)
-			if(E->parallel.NUM_PASS[levmax].bound[i][k])
+		{
+			n = H->num[i][k];
+			idx = H->idx[i][k];
+			for(f = 0; f < nf; f++)
 			{
-				for(j = 1; j <= E->parallel.NUM_NEQ[lev].pass[i][k]; j++)
-					S[k][j - 1] = U[E->parallel.EXCHANGE_ID[lev][j].pass[i][k]];
-
-				target_proc = E->parallel.PROCESSOR[lev].pass[i][k];
-				if(target_proc != E->parallel.me)
-				{
-					idb++;
-					MPI_Isend(S[k], E->parallel.NUM_NEQ[lev].pass[i][k], MPI_DOUBLE, target_proc, 1, MPI_COMM_WORLD, &request[idb - 1]);
-				}
-			}					/* for k */
+				B = S[k] + f * n;
+				for(j = 0; j < n; j++)
+					B[j] = U[f][idx[j]];
+			}
+		}
 
 		for(k = 1; k <= 2; k++)
-			if(E->parallel.NUM_PASS[levmax].bound[i][k])
-			{
-
-				target_proc = E->parallel.PROCESSOR[lev].pass[i][k];
-				if(target_proc != E->parallel.me)
-				{
-					idb++;
-					MPI_Irecv(R[k], E->parallel.NUM_NEQ[lev].pass[i][k], MPI_DOUBLE, target_proc, 1, MPI_COMM_WORLD, &request[idb - 1]);
-				}
-			}					/* for k */
+			if(E->parallel.NUM_PASS[levmax].bound[i][k] && !H->self[i][k])
+				MPI_Isend(S[k], nf * H->num[i][k], MPI_DOUBLE, E->parallel.PROCESSOR[lev].pass[i][k], 1, MPI_COMM_WORLD, &request[idb++]);
+		for(k = 1; k <= 2; k++)
+			if(E->parallel.NUM_PASS[levmax].bound[i][k] && !H->self[i][k])
+				MPI_Irecv(R[k], nf * H->num[i][k], MPI_DOUBLE, E->parallel.PROCESSOR[lev].pass[i][k], 1, MPI_COMM_WORLD, &request[idb++]);
 
-		MPI_Waitall(idb, request, status);
+		MPI_Waitall(idb, request, MPI_STATUSES_IGNORE);
 
 		for(k = 1; k <= 2; k++)
-			if(E->parallel.NUM_PASS[levmax].bound[i][k])
+		{
+			n = H->num[i][k];
+			idx = H->idx[i][k];
+			for(f = 0; f < nf; f++)
 			{
-				target_proc = E->parallel.PROCESSOR[lev].pass[i][k];
-				if(target_proc != E->parallel.me)
-				{
-					for(j = 1; j <= E->parallel.NUM_NEQ[lev].pass[i][k]; j++)
-						U[E->parallel.EXCHANGE_ID[lev][j].pass[i][k]] += R[k][j - 1];
-				}
-				else
-				{
-					kk = 1;
-					if(k == 1)
-						kk = 2;
-					for(j = 1; j <= E->parallel.NUM_NEQ[lev].pass[i][k]; j++)
-						U[E->parallel.EXCHANGE_ID[lev][j].pass[i][k]] += S[kk][j - 1];
-				}
-			}					/* for k */
-
+				B = (H->self[i][k] ? S[3 - k] : R[k]) + f * n;
+				for(j = 0; j < n; j++)
+					U[f][idx[j]] += B[j];
+			}
+		}
 	}							/* for dim */
 
 	return;
 }
 
-
-void exchange_node_f20(struct All_variables *E, float *U, int lev)
+void exchange_node_f20_fields(struct All_variables *E, float **U, int nf, int lev)
 {
-	//int target_proc, kk, e, node, i, ii, j, k, bound, type, idb, msginfo[8];
-	int target_proc, kk, i, j, k, idb;
-	static float *S[27], *R[27];
+	int i, j, k, f, n, idb;
+	int *idx;
+	float *B;
+	static float *S[3], *R[3];
+	static int size = 0;
+	MPI_Request request[4];
+	struct HALO_PASS *H;
 
-	static int been_here = 0;
-	//static int mid_recv, sizeofk;
-	static int sizeofk;
 	const int levmax = E->mesh.levmax;
 
-	MPI_Status status[CU_MPI_MSG_LIM];
-	MPI_Request request[CU_MPI_MSG_LIM];
-	//if(E->parallel.me == 0)fprintf(stderr,"exchange_node_f20: ok0 init %i\n",been_here);
-	if(been_here == 0)
-	{
-	  sizeofk = 0;
-	  for(i = 1; i <= E->mesh.nsd; i++)
-	    for(k = 1; k <= 2; k++)
-	      {
-		if(E->parallel.NUM_PASS[levmax].bound[i][k])
-		  sizeofk = max(sizeofk, (1 + E->parallel.NUM_NODE[levmax].pass[i][k]) * sizeof(float));
-		
-	      }
-	  for(k = 1; k <= 2; k++)
-	    {
-	      S[k] = (float *)safe_malloc(sizeofk);
-	      R[k] = (float *)safe_malloc(sizeofk);
-	    }
-
+	halo_setup(E);
+	H = &halo_node[lev];
 
-	  been_here++;
+	if(nf * halo_node_max > size)
+	{
+		size = nf * halo_node_max;
+		for(k = 1; k <= 2; k++)
+		{
+			/* old contents are not needed, only the larger size */
+			free((void *)S[k]);
+			free((void *)R[k]);
+			S[k] = (float *)safe_malloc(size * sizeof(float));
+			R[k] = (float *)safe_malloc(size * sizeof(float));
+		}
 	}
-	//if(E->parallel.me == 0)fprintf(stderr,"%i: exchange_node_f20: ok1 \n",E->parallel.me);
+
 	for(i = 1; i <= E->mesh.nsd; i++)
 	{
 		idb = 0;
 		for(k = 1; k <= 2; k++)
-			if(E->parallel.NUM_PASS[levmax].bound[i][k])
+		{
+			n = H->num[i][k];
+			idx = H->idx[i][k];
+			for(f = 0; f < nf; f++)
 			{
-				for(j = 1; j <= E->parallel.NUM_NODE[lev].pass[i][k]; j++)
-					S[k][j - 1] = U[E->parallel.EXCHANGE_NODE[lev][j].pass[i][k]];
-
-				target_proc = E->parallel.PROCESSOR[lev].pass[i][k];
-				if(target_proc != E->parallel.me)
-				{
-					idb++;
-					MPI_Isend(S[k], E->parallel.NUM_NODE[lev].pass[i][k], MPI_FLOAT, target_proc, 1, MPI_COMM_WORLD, &request[idb - 1]);
-				}
-			}					/* for k */
+				B = S[k] + f * n;
+				for(j = 0; j < n; j++)
+					B[j] = U[f][idx[j]];
+			}
+		}
 
 		for(k = 1; k <= 2; k++)
-			if(E->parallel.NUM_PASS[levmax].bound[i][k])
-			{
+			if(E->parallel.NUM_PASS[levmax].bound[i][k] && !H->self[i][k])
+				MPI_Isend(S[k], nf * H->num[i][k], MPI_FLOAT, E->parallel.PROCESSOR[lev].pass[i][k], 1, MPI_COMM_WORLD, &request[idb++]);
+		for(k = 1; k <= 2; k++)
+			if(E->parallel.NUM_PASS[levmax].bound[i][k] && !H->self[i][k])
+				MPI_Irecv(R[k], nf * H->num[i][k], MPI_FLOAT, E->parallel.PROCESSOR[lev].pass[i][k], 1, MPI_COMM_WORLD, &request[idb++]);
 
-				target_proc = E->parallel.PROCESSOR[lev].pass[i][k];
-				if(target_proc != E->parallel.me)
-				{
-					idb++;
-					MPI_Irecv(R[k], E->parallel.NUM_NODE[lev].pass[i][k], MPI_FLOAT, target_proc, 1, MPI_COMM_WORLD, &request[idb - 1]);
-				}
-			}					/* for k */
-		//if(E->parallel.me == 0)fprintf(stderr,"exchange_node_f20: ok2 \n");
-		MPI_Waitall(idb, request, status);
-
-		for(k = 1; k <= 2; k++){
-			if(E->parallel.NUM_PASS[levmax].bound[i][k])
+		MPI_Waitall(idb, request, MPI_STATUSES_IGNORE);
+
+		for(k = 1; k <= 2; k++)
+		{
+			n = H->num[i][k];
+			idx = H->idx[i][k];
+			for(f = 0; f < nf; f++)
 			{
-				target_proc = E->parallel.PROCESSOR[lev].pass[i][k];
-				//if(E->parallel.me == 0)fprintf(stderr,"exchange_node_f20: t %3i i am %3i \n",target_proc,E->parallel.me);
-				if(target_proc != E->parallel.me)
-				{
-					for(j = 1; j <= E->parallel.NUM_NODE[lev].pass[i][k]; j++)
-						U[E->parallel.EXCHANGE_NODE[lev][j].pass[i][k]] += R[k][j - 1];
-				}
-				else
-				{
-					kk = 1;
-					if(k == 1)
-						kk = 2;
-					for(j = 1; j <= E->parallel.NUM_NODE[lev].pass[i][k]; j++)
-						U[E->parallel.EXCHANGE_NODE[lev][j].pass[i][k]] += S[kk][j - 1];
-				}
-				//if(E->parallel.me == 0)fprintf(stderr,"exchange_node_f20: ok\n");
-			}					/* for k */
+				B = (H->self[i][k] ? S[3 - k] : R[k]) + f * n;
+				for(j = 0; j < n; j++)
+					U[f][idx[j]] += B[j];
+			}
 		}
-		//if(E->parallel.me == 0)fprintf(stderr,"exchange_node_f20: ok3 \n");
 	}							/* for dim */
 
 	return;
 }
+
+
 void exchange_node_int(struct All_variables *E, int *U, int lev)
 {
   int target_proc, kk, i, j, k, idb;
@@ -66,6 +66,7 @@ void heat_flux(struct All_variables *E)
 	static float *flux;
 	static float *inp, *outp;
 	static int been_here = 0;
+	float *fields[3], *aves[3];
 	//double T1[9], VZ[9], u[9], T[9], dTdz[9], area, uT, uT_adv, uT_adv_s;
 	double T1[9], VZ[9], u[9], T[9], dTdz[9], uT, uT_adv, uT_adv_s;
 	double diff, tempb, tempt, hfb, hft, areab, areat;
@@ -144,9 +145,10 @@ void heat_flux(struct All_variables *E)
 		}
 	}							/* end of e */
 
-	exchange_node_f20(E, flux, lev);
-	exchange_node_f20(E, E->heatflux, lev);
-	exchange_node_f20(E, E->heatflux_adv, lev);
+	fields[0] = flux;
+	fields[1] = E->heatflux;
+	fields[2] = E->heatflux_adv;
+	exchange_node_f20_fields(E, fields, 3, lev);
 
 	for(i = 1; i <= nno; i++)
 	{
@@ -192,9 +194,13 @@ void heat_flux(struct All_variables *E)
 	E->slice.Nub = outp[0] / (outp[1] * enodes[dims - 1]);
 	E->slice.Nut = outp[2] / (outp[3] * enodes[dims - 1]);
 
-	return_horiz_ave(E, E->heatflux, E->Have.Rho);
-	return_horiz_ave(E, E->heatflux_adv, E->Have.F);
-	return_horiz_ave(E, flux, E->Have.f);
+	fields[0] = E->heatflux;
+	fields[1] = E->heatflux_adv;
+	fields[2] = flux;
+	aves[0] = E->Have.Rho;
+	aves[1] = E->Have.F;
+	aves[2] = E->Have.f;
+	return_horiz_ave_fields(E, fields, aves, 3);
 
 	for(i = 1; i <= nno; i++)
 		E->heatflux[i] = flux[i];
@@ -181,14 +181,18 @@ void averages(struct All_variables *E)
 	//int lev, i, j, el;
 	int lev, i;
 	float *temp, z_thld;
+	float *fields[2], *aves[2];
 
 	lev = E->mesh.levmax;
 
 	temp = (float *)malloc((E->lmesh.nno + 1) * sizeof(float));
 
 	visc_from_gint_to_nodes(E, E->EVI[lev], temp, lev);
-	return_horiz_ave(E, temp, E->Have.Vi);
-	return_horiz_ave(E, E->C, E->Have.C);
+	fields[0] = temp;
+	fields[1] = E->C;
+	aves[0] = E->Have.Vi;
+	aves[1] = E->Have.C;
+	return_horiz_ave_fields(E, fields, aves, 2);
 
 	z_thld = -0.1;
 //  fprintf(E->fp,"oooo\n");fflush(E->fp);
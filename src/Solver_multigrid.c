@@ -94,6 +94,12 @@ void project_vector(
 	//const double weight = (double)1.0 / ends;
 
 
+	if(E->control.mg_visc_transfer)
+	{
+		project_vector_weighted(E, start_lev, AU, AD);
+		return;
+	}
+
 	/* on the lower level the average value of data in upper level
 	 * ELEMENTS are slid across to the nodes.  */
 
@@ -200,11 +206,19 @@ void interp_vector(struct All_variables *E, int start_lev, double *AD, double *A
 				node1 = node0 - noz;
 				node2 = node0 + noz;
 
-				x1 = E->ECO[level][E->NEI[level].element[ends * (node1 - 1)]].size[1];
-				x2 = E->ECO[level][E->NEI[level].element[(node2 - 1) * ends]].size[1];
+				if(E->control.mg_visc_transfer)
+				{
+					n1 = E->MGW[level][3 * (node0 - 1)];
+					n2 = 1.0 - n1;
+				}
+				else
+				{
+					x1 = E->ECO[level][E->NEI[level].element[ends * (node1 - 1)]].size[1];
+					x2 = E->ECO[level][E->NEI[level].element[(node2 - 1) * ends]].size[1];
 
-				n1 = x2 / (x1 + x2);
-				n2 = x1 / (x1 + x2);
+					n1 = x2 / (x1 + x2);
+					n2 = x1 / (x1 + x2);
+				}
 
 				/* now for each direction */
 
@@ -237,11 +251,19 @@ void interp_vector(struct All_variables *E, int start_lev, double *AD, double *A
 				node1 = node0 - 1;
 				node2 = node0 + 1;
 
-				x1 = E->ECO[level][E->NEI[level].element[ends * (node1 - 1)]].size[3];
-				x2 = E->ECO[level][E->NEI[level].element[(node2 - 1) * ends]].size[3];
+				if(E->control.mg_visc_transfer)
+				{
+					n1 = E->MGW[level][3 * (node0 - 1) + 2];
+					n2 = 1.0 - n1;
+				}
+				else
+				{
+					x1 = E->ECO[level][E->NEI[level].element[ends * (node1 - 1)]].size[3];
+					x2 = E->ECO[level][E->NEI[level].element[(node2 - 1) * ends]].size[3];
 
-				n1 = x2 / (x1 + x2);
-				n2 = x1 / (x1 + x2);
+					n1 = x2 / (x1 + x2);
+					n2 = x1 / (x1 + x2);
+				}
 
 				eqn0 = E->ID[level][node0].doff[1];
 				eqn1 = E->ID[level][node1].doff[1];
@@ -272,11 +294,19 @@ void interp_vector(struct All_variables *E, int start_lev, double *AD, double *A
 					node1 = node0 - nox * noz;
 					node2 = node0 + nox * noz;
 
-					x1 = E->ECO[level][E->NEI[level].element[ends * (node1 - 1)]].size[2];
-					x2 = E->ECO[level][E->NEI[level].element[(node2 - 1) * ends]].size[2];
+					if(E->control.mg_visc_transfer)
+					{
+						n1 = E->MGW[level][3 * (node0 - 1) + 1];
+						n2 = 1.0 - n1;
+					}
+					else
+					{
+						x1 = E->ECO[level][E->NEI[level].element[ends * (node1 - 1)]].size[2];
+						x2 = E->ECO[level][E->NEI[level].element[(node2 - 1) * ends]].size[2];
 
-					n1 = x2 / (x1 + x2);
-					n2 = x1 / (x1 + x2);
+						n1 = x2 / (x1 + x2);
+						n2 = x1 / (x1 + x2);
+					}
 
 					eqn0 = E->ID[level][node0].doff[1];
 					eqn1 = E->ID[level][node1].doff[1];
@@ -297,6 +327,196 @@ void interp_vector(struct All_variables *E, int start_lev, double *AD, double *A
 
 }
 
+/* =======================================================================================
+   Viscosity weighted transfer (mg_visc_transfer=on). Each gap node that interp_vector
+   fills from two neighbours along an axis gets weights in proportion to the stiffness
+   eta/h of the elements on either side, rather than to the distance. A correction on
+   the stiff side of a viscosity jump then stays there instead of being smeared across
+   into the weak material. For uniform viscosity the weights are the geometric ones.
+   The restriction is the transpose of that interpolation.
+   ======================================================================================= */
+
+void construct_mg_transfer_weights(struct All_variables *E)
+{
+	static int been_here = 0;
+	static float *w[6];
+	int lev, i, a, ex, ey, ez, dx, dy, dz, e, k, node, side[4];
+	int elx, elz, ely, nox, noz, nno;
+	float eta;
+
+	const int vpts = vpoints[E->mesh.nsd];
+
+	if(been_here == 0)
+	{
+		for(lev = E->mesh.levmin + 1; lev <= E->mesh.levmax; lev++)
+			E->MGW[lev] = (float *)safe_malloc((3 * E->lmesh.NNO[lev] + 3) * sizeof(float));
+		for(a = 0; a < 6; a++)
+			w[a] = (float *)safe_malloc((E->lmesh.NNO[E->mesh.levmax] + 1) * sizeof(float));
+		been_here = 1;
+	}
+
+	for(lev = E->mesh.levmin + 1; lev <= E->mesh.levmax; lev++)
+	{
+		nox = E->lmesh.NOX[lev];
+		noz = E->lmesh.NOZ[lev];
+		elx = E->lmesh.ELX[lev];
+		elz = E->lmesh.ELZ[lev];
+		ely = E->lmesh.ELY[lev];
+		nno = E->lmesh.NNO[lev];
+
+		for(a = 0; a < 6; a++)
+			for(i = 1; i <= nno; i++)
+				w[a][i] = 0.0;
+
+		/* w[2*(axis-1)] collects eta/h of the elements below a node along the
+		   axis, w[2*(axis-1)+1] of those above it */
+
+		for(ey = 1; ey <= ely; ey++)
+			for(ex = 1; ex <= elx; ex++)
+				for(ez = 1; ez <= elz; ez++)
+				{
+					e = ez + (ex - 1) * elz + (ey - 1) * elz * elx;
+					eta = 0.0;
+					for(k = 1; k <= vpts; k++)
+						eta += E->EVI[lev][(e - 1) * vpts + k];
+					eta /= vpts;
+
+					for(dy = 0; dy <= 1; dy++)
+						for(dx = 0; dx <= 1; dx++)
+							for(dz = 0; dz <= 1; dz++)
+							{
+								node = ez + dz + (ex + dx - 1) * noz + (ey + dy - 1) * noz * nox;
+								side[1] = 1 - dx;
+								side[2] = 1 - dy;
+								side[3] = 1 - dz;
+								for(a = 1; a <= 3; a++)
+									w[2 * (a - 1) + side[a]][node] += eta / E->ECO[lev][e].size[a];
+							}
+				}
+
+		/* elements across a processor boundary belong to the neighbour */
+		exchange_node_f20_fields(E, w, 6, lev);
+
+		for(i = 1; i <= nno; i++)
+			for(a = 1; a <= 3; a++)
+			{
+				eta = w[2 * (a - 1)][i] + w[2 * (a - 1) + 1][i];
+				E->MGW[lev][3 * (i - 1) + a - 1] = (eta > 0.0) ? w[2 * (a - 1)][i] / eta : 0.5;
+			}
+	}
+
+	return;
+}
+
+/* project_vector_weighted
+ *	the transpose of interp_vector with the viscosity weights, applied
+ *	to the owned part of AU and scaled back to an average
+ */
+void project_vector_weighted(struct All_variables *E, int start_lev, double *AU, double *AD)
+{
+	static int been_here = 0;
+	static double *t;
+	int i, j, k, d, node0, node1, node2, stride;
+	int eqn0;
+	float n1, n2;
+
+	const int sl_minus = start_lev - 1;
+	const int neq = E->lmesh.NEQ[start_lev];
+	const int neq_minus = E->lmesh.NEQ[sl_minus];
+	const int nox = E->lmesh.NOX[start_lev];
+	const int noz = E->lmesh.NOZ[start_lev];
+	const int noy = E->lmesh.NOY[start_lev];
+	const int noxc = E->lmesh.NOX[sl_minus];
+	const int nozc = E->lmesh.NOZ[sl_minus];
+	const int noyc = E->lmesh.NOY[sl_minus];
+
+	if(been_here == 0)
+	{
+		t = (double *)safe_malloc((E->lmesh.NEQ[E->mesh.levmax] + 2) * sizeof(double));
+		been_here = 1;
+	}
+
+	/* shared equations are complete on every processor, keep one copy */
+	for(i = 0; i < neq; i++)
+		t[i] = E->parallel.IDD[start_lev][i] ? AU[i] : 0.0;
+
+	/* undo the passes of interp_vector in reverse order: y, z, x */
+
+	stride = nox * noz;
+	for(i = 1; i <= nox; i++)
+		for(j = 1; j <= noz; j++)
+			for(k = 2; k < noy; k += 2)
+			{
+				node0 = j + (i - 1) * noz + (k - 1) * stride;
+				node1 = node0 - stride;
+				node2 = node0 + stride;
+				n1 = E->MGW[start_lev][3 * (node0 - 1) + 1];
+				n2 = 1.0 - n1;
+				for(d = 1; d <= 3; d++)
+				{
+					eqn0 = E->ID[start_lev][node0].doff[d];
+					t[E->ID[start_lev][node1].doff[d]] += n1 * t[eqn0];
+					t[E->ID[start_lev][node2].doff[d]] += n2 * t[eqn0];
+				}
+			}
+
+	for(k = 1; k <= noy; k += 2)
+		for(i = 1; i <= nox; i++)
+			for(j = 2; j < noz; j += 2)
+			{
+				node0 = j + (i - 1) * noz + (k - 1) * stride;
+				node1 = node0 - 1;
+				node2 = node0 + 1;
+				n1 = E->MGW[start_lev][3 * (node0 - 1) + 2];
+				n2 = 1.0 - n1;
+				for(d = 1; d <= 3; d++)
+				{
+					eqn0 = E->ID[start_lev][node0].doff[d];
+					t[E->ID[start_lev][node1].doff[d]] += n1 * t[eqn0];
+					t[E->ID[start_lev][node2].doff[d]] += n2 * t[eqn0];
+				}
+			}
+
+	for(k = 1; k <= noy; k += 2)
+		for(j = 1; j <= noz; j += 2)
+			for(i = 2; i < nox; i += 2)
+			{
+				node0 = j + (i - 1) * noz + (k - 1) * stride;
+				node1 = node0 - noz;
+				node2 = node0 + noz;
+				n1 = E->MGW[start_lev][3 * (node0 - 1)];
+				n2 = 1.0 - n1;
+				for(d = 1; d <= 3; d++)
+				{
+					eqn0 = E->ID[start_lev][node0].doff[d];
+					t[E->ID[start_lev][node1].doff[d]] += n1 * t[eqn0];
+					t[E->ID[start_lev][node2].doff[d]] += n2 * t[eqn0];
+				}
+			}
+
+	/* and the injection */
+
+	for(i = 0; i <= neq_minus; i++)
+		AD[i] = 0.0;
+
+	for(k = 1; k <= noyc; k++)
+		for(i = 1; i <= noxc; i++)
+			for(j = 1; j <= nozc; j++)
+			{
+				node0 = j + (i - 1) * nozc + (k - 1) * nozc * noxc;
+				node1 = 2 * j - 1 + (2 * i - 2) * noz + (2 * k - 2) * stride;
+				for(d = 1; d <= 3; d++)
+					AD[E->ID[sl_minus][node0].doff[d]] = t[E->ID[start_lev][node1].doff[d]];
+			}
+
+	exchange_id_d20(E, AD, sl_minus);
+
+	for(i = 0; i < neq_minus; i++)
+		AD[i] *= 0.125;
+
+	return;
+}
+
 /* ==================================================== */
 
 /* project_scalar_e
@@ -390,6 +610,96 @@ void project_scalar(struct All_variables *E, int start_lev, float *AU, float *AD
 
 
 
+#ifdef CITCOM_ALLOW_ANISOTROPIC_VISC
+/* visc_from_gint_to_nodes, project_scalar and visc_from_nodes_to_gint
+ * for nf viscosity fields of level lv at once (smooth_cycles = 1), so
+ * that the two node exchanges carry all of them */
+static void project_visc_fields(struct All_variables *E, float **VE, float **VE_minus, int nf, int lv)
+{
+	int f, e, i, j, n, el, node, node1;
+	double temp_visc;
+	float average, w;
+	float *VN[5], *VD[5];
+
+	static int been_here = 0;
+	static float *viscU[5], *viscD[5];
+
+	const int sl_minus = lv - 1;
+	const int nsd = E->mesh.nsd;
+	const int vpts = vpoints[nsd];
+	const int ends = enodes[nsd];
+	const double weight = (double)1.0 / ends;
+
+	if(been_here == 0)
+	{
+		for(f = 0; f < 5; f++)
+		{
+			viscU[f] = (float *)safe_malloc((1 + E->lmesh.NNO[E->mesh.levmax]) * sizeof(float));
+			viscD[f] = (float *)safe_malloc((1 + E->lmesh.NNO[E->mesh.levmax]) * sizeof(float));
+		}
+		been_here = 1;
+	}
+
+	for(f = 0; f < nf; f++)
+	{
+		VN[f] = viscU[f];
+		VD[f] = viscD[f];
+
+		for(i = 1; i <= E->lmesh.NNO[lv]; i++)
+			VN[f][i] = 0.0;
+		for(e = 1; e <= E->lmesh.NEL[lv]; e++)
+		{
+			temp_visc = 0.0;
+			for(i = 1; i <= vpts; i++)
+				temp_visc += VE[f][(e - 1) * vpts + i];
+			temp_visc = temp_visc / vpts;
+			for(j = 1; j <= ends; j++)
+			{
+				n = E->IEN[lv][e].node[j];
+				VN[f][n] += E->TWW[lv][e].node[j] * temp_visc;
+			}
+		}
+	}
+
+	exchange_node_f20_fields(E, VN, nf, lv);
+
+	for(f = 0; f < nf; f++)
+	{
+		for(n = 1; n <= E->lmesh.NNO[lv]; n++)
+			VN[f][n] *= E->MASS[lv][n];
+
+		for(i = 1; i <= E->lmesh.NNO[sl_minus]; i++)
+			VD[f][i] = 0.0;
+		for(el = 1; el <= E->lmesh.NEL[sl_minus]; el++)
+			for(i = 1; i <= ends; i++)
+			{
+				average = 0.0;
+				node1 = E->EL[sl_minus][el].sub[i];
+				for(j = 1; j <= ends; j++)
+				{
+					node = E->IEN[lv][node1].node[j];
+					average += VN[f][node];
+				}
+				w = weight * average;
+				node = E->IEN[sl_minus][el].node[i];
+				VD[f][node] += w * E->TWW[sl_minus][el].node[i];
+			}
+	}
+
+	exchange_node_f20_fields(E, VD, nf, sl_minus);
+
+	for(f = 0; f < nf; f++)
+	{
+		for(i = 1; i <= E->lmesh.NNO[sl_minus]; i++)
+			VD[f][i] *= E->MASS[sl_minus][i];
+		visc_from_nodes_to_gint(E, VD[f], VE_minus[f], sl_minus);
+	}
+
+	return;
+}
+#endif
+
+
 /*  ==============================================
     function to project viscosity down to all the 
     levels in the problem. (no gaps for vbcs)
@@ -404,6 +714,9 @@ void project_viscosity(struct All_variables *E)
 	const int vpts = vpoints[nsd];
 
 	float *viscU, *viscD;
+#ifdef CITCOM_ALLOW_ANISOTROPIC_VISC
+	float *fields[5], *fields_minus[5];
+#endif
 
 	viscU = (float *)malloc((1 + E->lmesh.NNO[E->mesh.levmax]) * sizeof(float));
 	viscD = (float *)malloc((1 + vpts * E->lmesh.NNO[E->mesh.levmax - 1]) * sizeof(float));
@@ -413,11 +726,9 @@ void project_viscosity(struct All_variables *E)
 	  for(lv = E->mesh.levmax; lv > E->mesh.levmin; lv--){
 	    sl_minus = lv - 1;
 	    if(E->viscosity.smooth_cycles == 1){
-	      visc_from_gint_to_nodes(E, E->EVI[lv], viscU, lv);project_scalar(E, lv, viscU, viscD);visc_from_nodes_to_gint(E, viscD, E->EVI[sl_minus], sl_minus);
-	      visc_from_gint_to_nodes(E, E->EVI2[lv], viscU, lv);project_scalar(E, lv, viscU, viscD);visc_from_nodes_to_gint(E, viscD, E->EVI2[sl_minus], sl_minus);
-	      visc_from_gint_to_nodes(E, E->EVIn1[lv], viscU, lv);project_scalar(E, lv, viscU, viscD);visc_from_nodes_to_gint(E, viscD, E->EVIn1[sl_minus], sl_minus);
-	      visc_from_gint_to_nodes(E, E->EVIn2[lv], viscU, lv);project_scalar(E, lv, viscU, viscD);visc_from_nodes_to_gint(E, viscD, E->EVIn2[sl_minus], sl_minus);
-	      visc_from_gint_to_nodes(E, E->EVIn3[lv], viscU, lv);project_scalar(E, lv, viscU, viscD);visc_from_nodes_to_gint(E, viscD, E->EVIn3[sl_minus], sl_minus);
+	      fields[0] = E->EVI[lv]; fields[1] = E->EVI2[lv]; fields[2] = E->EVIn1[lv]; fields[3] = E->EVIn2[lv]; fields[4] = E->EVIn3[lv];
+	      fields_minus[0] = E->EVI[sl_minus]; fields_minus[1] = E->EVI2[sl_minus]; fields_minus[2] = E->EVIn1[sl_minus]; fields_minus[3] = E->EVIn2[sl_minus]; fields_minus[4] = E->EVIn3[sl_minus];
+	      project_visc_fields(E, fields, fields_minus, 5, lv);
 	    }else if(E->viscosity.smooth_cycles == 2){
 	      visc_from_gint_to_ele(E, E->EVI[lv], viscU, lv);inject_scalar_e(E, lv, viscU, E->EVI[sl_minus]);
 	      visc_from_gint_to_ele(E, E->EVI2[lv], viscU, lv);inject_scalar_e(E, lv, viscU, E->EVI2[sl_minus]);
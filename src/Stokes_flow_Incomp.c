@@ -76,7 +76,10 @@ void solve_constrained_flow_iterative(struct All_variables *E)
 
 	/* Solve for velocity and pressure, correct for bc's */
 
-	residual_ddash = solve_Ahat_p_fhat(E, E->U, E->P, E->F, E->control.accuracy, &cycles);
+	if(E->control.stokes_fgmres)
+		residual_ddash = solve_Ahat_p_fhat_fgmres(E, E->U, E->P, E->F, E->control.accuracy, &cycles);
+	else
+		residual_ddash = solve_Ahat_p_fhat(E, E->U, E->P, E->F, E->control.accuracy, &cycles);
 
 	been_here = 1;
 
@@ -306,6 +309,8 @@ float solve_Ahat_p_fhat(struct All_variables *E, double *V, double *P,
 	//double *shuffle, *R;
 	double *shuffle;
 	double alpha, delta, s2dotAhat, r0dotr0, r1dotz1;
+	double dots[6];
+	double v_acc, eta, eta_prev;
 	//double residual, initial_residual, last_residual, res_magnitude, v_res;
 	double residual, initial_residual, res_magnitude, v_res;
 	char message[500];
@@ -390,20 +395,21 @@ float solve_Ahat_p_fhat(struct All_variables *E, double *V, double *P,
 
 /*   while( (count < *steps_max) && (E->monitor.incompressibility >= E->control.tole_comp || dvelocity >= imp) )  {     
 */ 
-	while((count < *steps_max) && (dpressure >= imp || dvelocity >= imp))
-	{
+	/* r1.z1 of the following iterations comes with the batched
+	 * dot products at the end of the loop */
+	schur_precondition(E, r1, z1, lev);
 
-		for(j = 1; j <= npno; j++)
-			z1[j] = E->BPI[lev][j] * r1[j];
+	r1dotz1 = global_pdot(E, r1, z1, lev);
+	r0dotr0 = 0.0;
 
-		r1dotz1 = global_pdot(E, r1, z1, lev);
+	while((count < *steps_max) && (dpressure >= imp || dvelocity >= imp))
+	{
 
 		if((count == 0))
 			for(j = 1; j <= npno; j++)
 				s2[j] = z1[j];
 		else
 		{
-			r0dotr0 = global_pdot(E, r0, z0, lev);
 			assert(r0dotr0 != 0.0 /* Division by zero in head of incompressibility iteration */ );
 			delta = r1dotz1 / r0dotr0;
 			for(j = 1; j <= npno; j++)
@@ -412,7 +418,27 @@ float solve_Ahat_p_fhat(struct All_variables *E, double *V, double *P,
 
 		assemble_grad_p(E, s2, Ah, lev);
 
-		valid = solve_del2_u(E, u1, Ah, imp * v_res, lev);
+		/* Eisenstat-Walker forcing: the velocity only needs to be
+		 * as good as the current pressure step */
+		v_acc = imp * v_res;
+		if(E->control.uzawa_ew)
+		{
+			if(count == 0)
+				eta = 0.9;
+			else
+			{
+				eta_prev = eta;
+				eta = E->control.ew_gamma * r1dotz1 / r0dotr0;
+				if(E->control.ew_gamma * eta_prev * eta_prev > 0.1)
+					eta = max(eta, E->control.ew_gamma * eta_prev * eta_prev);
+				eta = min(eta, 0.9);
+			}
+			v_acc *= min(E->control.ew_max, max(1.0, eta * max(dpressure, dvelocity) / imp));
+		}
+
+		valid = solve_del2_u(E, u1, Ah, v_acc, lev);
+		if(!valid && v_acc > imp * v_res)	/* loosened too far to do any work */
+			valid = solve_del2_u(E, u1, Ah, imp * v_res, lev);
 		strip_bcs_from_residual(E, u1, lev);
 
 		assemble_div_u(E, u1, Ah, lev);
@@ -434,17 +460,34 @@ float solve_Ahat_p_fhat(struct All_variables *E, double *V, double *P,
 			V[j] -= alpha * u1[j];
 
 		assemble_div_u(E, V, Ah, lev);
+
+		/* z0 is free again: precondition the new residual now */
+		schur_precondition(E, r2, z0, lev);
+
+		/* the remaining dot products are independent, so they
+		 * are summed across processors in a single reduction */
+		dots[0] = local_vdot(E, V, V, lev);
+		dots[1] = local_pdot(E, P, P, lev);
+		dots[2] = local_pdot(E, Ah, Ah, lev);
+		dots[3] = local_pdot(E, s2, s2, lev);
+		dots[4] = local_vdot(E, u1, u1, lev);
+		dots[5] = local_pdot(E, r2, z0, lev);
+		global_sums(E, dots, 6);
+
 		/* this is how it was computed before */
-		E->monitor.vdotv = global_vdot(E, V, V, lev);
-		E->monitor.pdotp = global_pdot(E, P, P, lev);
+		E->monitor.vdotv = dots[0];
+		E->monitor.pdotp = dots[1];
 		
-		E->monitor.incompressibility = sqrt((gneq / gnpno) * (1.0e-32 + global_pdot(E, Ah, Ah, lev) / (1.0e-32 + E->monitor.vdotv)));
-		dpressure = alpha * sqrt(global_pdot(E, s2, s2, lev) / (1.0e-32 + E->monitor.pdotp));
-		dvelocity = alpha * sqrt(global_vdot(E, u1, u1, lev) / (1.0e-32 + E->monitor.vdotv));
+		E->monitor.incompressibility = sqrt((gneq / gnpno) * (1.0e-32 + dots[2] / (1.0e-32 + E->monitor.vdotv)));
+		dpressure = alpha * sqrt(dots[3] / (1.0e-32 + E->monitor.pdotp));
+		dvelocity = alpha * sqrt(dots[4] / (1.0e-32 + E->monitor.vdotv));
 		/* keep the normalized versions for the message */
 		E->monitor.vdotv = sqrt(E->monitor.vdotv/gneq);
 		E->monitor.pdotp = sqrt(E->monitor.pdotp/gnpno);
 
+		r0dotr0 = r1dotz1;
+		r1dotz1 = dots[5];
+
 		count++;
 
 		generate_log_message(count,time0,timea,dvelocity, dpressure,E);
@@ -463,6 +506,21 @@ float solve_Ahat_p_fhat(struct All_variables *E, double *V, double *P,
 
 	}							/* end loop for conjugate gradient   */
 
+	/* with inexact inner solves V has drifted from P: correct it
+	 * to the full accuracy once, as on entry */
+	if(E->control.uzawa_ew && count > 0)
+	{
+		assemble_grad_p(E, P, Ah, lev);
+		assemble_del2_u(E, V, u1, lev, 1);
+		for(i = 0; i < neq; i++)
+			Ah[i] = F[i] - Ah[i] - u1[i];
+		strip_bcs_from_residual(E, Ah, lev);
+		valid = solve_del2_u(E, u1, Ah, imp * v_res, lev);
+		strip_bcs_from_residual(E, u1, lev);
+		for(i = 0; i < neq; i++)
+			V[i] += u1[i];
+	}
+
 	if(problems)
 	{
 		fprintf(E->fp, "Convergence of velocity solver may affect continuity\n");
@@ -498,6 +556,360 @@ float solve_Ahat_p_fhat(struct All_variables *E, double *V, double *P,
 
 
 
+/*  ==========================================================================  
+
+ Alternative to the Uzawa loop: restarted flexible GMRES on the whole
+ [K G; D 0] [V; P] = [F; 0] system, right-preconditioned by the block
+ upper triangular [K G; 0 -S], with one multi_grid V-cycle for K and
+ schur_precondition for the Schur complement S. Each iteration costs one V-cycle, so
+ there is no inner velocity solve to tolerance.
+
+*/
+
+float solve_Ahat_p_fhat_fgmres(struct All_variables *E, double *V, double *P, 
+			       double *F, double imp, int *steps_max)
+{
+	static int been_here = 0;
+	static double **vu, **vp, **zu, **zp;
+	static double *ru, *rp, *t, *Au, *H, *cs, *sn, *g, *y, *dots;
+	int i, j, k, pass, count, lev, npno, neq, gnpno, gneq;
+	double beta, target, hn, tmp, f_norm, residual;
+	double time0;
+	static double timea;
+	float dpressure, dvelocity;
+
+	const int m = E->control.stokes_restart;
+	const int max_its = *steps_max;
+
+	lev = E->mesh.levmax;
+	npno = E->lmesh.npno;
+	neq = E->lmesh.neq;
+	gnpno = E->mesh.npno;
+	gneq = E->mesh.neq;
+
+	if(been_here == 0)
+	{
+		vu = (double **)malloc((m + 1) * sizeof(double *));
+		vp = (double **)malloc((m + 1) * sizeof(double *));
+		zu = (double **)malloc(m * sizeof(double *));
+		zp = (double **)malloc(m * sizeof(double *));
+		for(k = 0; k <= m; k++)
+		{
+			vu[k] = (double *)malloc((neq + 2) * sizeof(double));
+			vp[k] = (double *)malloc((npno + 1) * sizeof(double));
+		}
+		for(k = 0; k < m; k++)
+		{
+			zu[k] = (double *)malloc((neq + 2) * sizeof(double));
+			zp[k] = (double *)malloc((npno + 1) * sizeof(double));
+		}
+		ru = (double *)malloc((neq + 2) * sizeof(double));
+		rp = (double *)malloc((npno + 1) * sizeof(double));
+		t = (double *)malloc((neq + 2) * sizeof(double));
+		Au = (double *)malloc((neq + 2) * sizeof(double));
+		H = (double *)malloc((m + 1) * m * sizeof(double));
+		cs = (double *)malloc(m * sizeof(double));
+		sn = (double *)malloc(m * sizeof(double));
+		g = (double *)malloc((m + 1) * sizeof(double));
+		y = (double *)malloc(m * sizeof(double));
+		dots = (double *)malloc((m + 4) * sizeof(double));
+
+		timea = CPU_time0();
+		been_here = 1;
+	}
+
+	time0 = CPU_time0();
+
+	f_norm = sqrt(global_vdot(E, F, F, lev));
+	target = imp * f_norm;
+
+	if(E->parallel.me == 0)
+		fprintf(stderr, "initial residue of momentum equation %g %d\n", f_norm / sqrt((double)gneq), gneq);
+
+	count = 0;
+	residual = 0.0;
+	dvelocity = dpressure = 1.0;
+
+	while(1)
+	{
+		/* true residual [F - K V - G P; - D V] at each restart */
+		assemble_grad_p(E, P, t, lev);
+		assemble_del2_u(E, V, Au, lev, 1);
+		for(i = 0; i < neq; i++)
+			ru[i] = F[i] - t[i] - Au[i];
+		strip_bcs_from_residual(E, ru, lev);
+		assemble_div_u(E, V, rp, lev);
+		for(i = 1; i <= npno; i++)
+			rp[i] = -rp[i];
+
+		dots[0] = local_vdot(E, ru, ru, lev);
+		dots[1] = local_pdot(E, rp, rp, lev);
+		dots[2] = local_vdot(E, V, V, lev);
+		dots[3] = local_pdot(E, P, P, lev);
+		global_sums(E, dots, 4);
+
+		beta = sqrt(dots[0] + dots[1]);
+		residual = sqrt(dots[1] / gnpno);
+		E->monitor.vdotv = sqrt(dots[2] / gneq);
+		E->monitor.pdotp = sqrt(dots[3] / gnpno);
+		E->monitor.incompressibility = residual / (1.0e-32 + E->monitor.vdotv);
+
+		if(beta <= target || count >= max_its)
+		{
+			dvelocity = dpressure = beta / (1.0e-32 + f_norm);
+			generate_log_message(count, time0, timea, dvelocity, dpressure, E);
+			break;
+		}
+		if(count == 0)
+			generate_log_message(count, time0, timea, dvelocity, dpressure, E);
+
+		for(i = 0; i < neq; i++)
+			vu[0][i] = ru[i] / beta;
+		for(i = 1; i <= npno; i++)
+			vp[0][i] = rp[i] / beta;
+		g[0] = beta;
+
+		for(j = 0; j < m && count < max_its; j++)
+		{
+			/* z = M^-1 v: pressure first, then the velocity
+			 * block with the pressure gradient moved across */
+			schur_precondition(E, vp[j], zp[j], lev);
+			for(i = 1; i <= npno; i++)
+				zp[j][i] = -zp[j][i];
+			assemble_grad_p(E, zp[j], t, lev);
+			for(i = 0; i < neq; i++)
+				t[i] = vu[j][i] - t[i];
+			strip_bcs_from_residual(E, t, lev);
+			(void)multi_grid(E, zu[j], t, Au, imp, lev);
+			strip_bcs_from_residual(E, zu[j], lev);
+
+			/* w = A z, built in v[j+1] */
+			assemble_del2_u(E, zu[j], Au, lev, 1);
+			assemble_grad_p(E, zp[j], t, lev);
+			for(i = 0; i < neq; i++)
+				vu[j + 1][i] = Au[i] + t[i];
+			assemble_div_u(E, zu[j], vp[j + 1], lev);
+
+			/* classical Gram-Schmidt, done twice, so that each
+			 * pass is a single batched reduction */
+			for(i = 0; i <= j; i++)
+				H[i * m + j] = 0.0;
+			for(pass = 0; pass < 2; pass++)
+			{
+				for(i = 0; i <= j; i++)
+					dots[i] = local_vdot(E, vu[j + 1], vu[i], lev) + local_pdot(E, vp[j + 1], vp[i], lev);
+				global_sums(E, dots, j + 1);
+				for(i = 0; i <= j; i++)
+				{
+					H[i * m + j] += dots[i];
+					for(k = 0; k < neq; k++)
+						vu[j + 1][k] -= dots[i] * vu[i][k];
+					for(k = 1; k <= npno; k++)
+						vp[j + 1][k] -= dots[i] * vp[i][k];
+				}
+			}
+
+			dots[0] = local_vdot(E, vu[j + 1], vu[j + 1], lev) + local_pdot(E, vp[j + 1], vp[j + 1], lev);
+			global_sums(E, dots, 1);
+			hn = sqrt(dots[0]);
+			H[(j + 1) * m + j] = hn;
+			if(hn > 0.0)
+			{
+				for(k = 0; k < neq; k++)
+					vu[j + 1][k] /= hn;
+				for(k = 1; k <= npno; k++)
+					vp[j + 1][k] /= hn;
+			}
+
+			/* Givens rotations keep H upper triangular */
+			for(i = 0; i < j; i++)
+			{
+				tmp = cs[i] * H[i * m + j] + sn[i] * H[(i + 1) * m + j];
+				H[(i + 1) * m + j] = -sn[i] * H[i * m + j] + cs[i] * H[(i + 1) * m + j];
+				H[i * m + j] = tmp;
+			}
+			tmp = sqrt(H[j * m + j] * H[j * m + j] + hn * hn);
+			cs[j] = H[j * m + j] / tmp;
+			sn[j] = hn / tmp;
+			H[j * m + j] = tmp;
+			g[j + 1] = -sn[j] * g[j];
+			g[j] = cs[j] * g[j];
+
+			count++;
+			dvelocity = dpressure = fabs(g[j + 1]) / (1.0e-32 + f_norm);
+			generate_log_message(count, time0, timea, dvelocity, dpressure, E);
+
+			if(fabs(g[j + 1]) <= target || hn == 0.0)
+			{
+				j++;
+				break;
+			}
+		}
+
+		/* back substitution, then V += Zu y and P += Zp y */
+		for(i = j - 1; i >= 0; i--)
+		{
+			y[i] = g[i];
+			for(k = i + 1; k < j; k++)
+				y[i] -= H[i * m + k] * y[k];
+			y[i] /= H[i * m + i];
+		}
+		for(i = 0; i < j; i++)
+		{
+			for(k = 0; k < neq; k++)
+				V[k] += y[i] * zu[i][k];
+			for(k = 1; k <= npno; k++)
+				P[k] += y[i] * zp[i][k];
+		}
+	}
+
+	if(E->control.print_convergence && E->parallel.me == 0)
+	{
+		fprintf(E->fp, "after (%03d) fgmres iterations and %g sec for step %d\n", count, CPU_time0() - timea, E->monitor.solution_cycles);
+		fprintf(stderr, "after (%03d) fgmres iterations and %g sec for step %d\n", count, CPU_time0() - timea, E->monitor.solution_cycles);
+		fflush(E->fp);
+	}
+
+	*steps_max = count;
+
+	return (residual);
+}
+
+
+
+/*  ==========================================================================  
+
+ Preconditioner z = S^-1 r for the Schur complement S = D K^-1 G, chosen
+ by schur_precond:
+   bpi       - BPI, inverse diagonal of D diag(K)^-1 G (the default)
+   visc_mass - the inverse of the pressure mass matrix weighted by 1/eta
+   bfbt      - scaled BFBt, (D C G)^-1 (D C K C G) (D C G)^-1, C = BI
+
+*/
+
+void schur_precondition(struct All_variables *E, double *r, double *z, int lev)
+{
+	static int been_here = 0;
+	static double *y, *t, *Kt;
+	int i;
+
+	const int npno = E->lmesh.NPNO[lev];
+	const int neq = E->lmesh.NEQ[lev];
+
+	switch (E->control.schur_precond)
+	{
+	case SCHUR_VISC_MASS:
+		for(i = 1; i <= npno; i++)
+			z[i] = E->BPM[lev][i] * r[i];
+		break;
+
+	case SCHUR_BFBT:
+		if(been_here == 0)
+		{
+			y = (double *)malloc((npno + 1) * sizeof(double));
+			t = (double *)malloc((neq + 2) * sizeof(double));
+			Kt = (double *)malloc((neq + 2) * sizeof(double));
+			been_here = 1;
+		}
+
+		bfbt_poisson(E, r, y, lev);
+
+		assemble_grad_p(E, y, t, lev);
+		for(i = 0; i < neq; i++)
+			t[i] *= E->BI[lev][i];
+		assemble_del2_u(E, t, Kt, lev, 1);
+		for(i = 0; i < neq; i++)
+			Kt[i] *= E->BI[lev][i];
+		assemble_div_u(E, Kt, y, lev);
+
+		bfbt_poisson(E, y, z, lev);
+		break;
+
+	default:
+		for(i = 1; i <= npno; i++)
+			z[i] = E->BPI[lev][i] * r[i];
+		break;
+	}
+
+	return;
+}
+
+
+/* solves D BI G y = r by Jacobi (BPI) preconditioned CG, to
+ * bfbt_accuracy relative to |r| */
+
+void bfbt_poisson(struct All_variables *E, double *r, double *y, int lev)
+{
+	static int been_here = 0;
+	static double *q, *z, *s, *Ap, *t;
+	int i, count;
+	double alpha, beta, rz, rz0, dots[2], target;
+
+	const int npno = E->lmesh.NPNO[lev];
+	const int neq = E->lmesh.NEQ[lev];
+
+	if(been_here == 0)
+	{
+		q = (double *)malloc((npno + 1) * sizeof(double));
+		z = (double *)malloc((npno + 1) * sizeof(double));
+		s = (double *)malloc((npno + 1) * sizeof(double));
+		Ap = (double *)malloc((npno + 1) * sizeof(double));
+		t = (double *)malloc((neq + 2) * sizeof(double));
+		been_here = 1;
+	}
+
+	for(i = 1; i <= npno; i++)
+	{
+		y[i] = 0.0;
+		q[i] = r[i];
+		z[i] = E->BPI[lev][i] * q[i];
+	}
+
+	dots[0] = local_pdot(E, q, z, lev);
+	dots[1] = local_pdot(E, q, q, lev);
+	global_sums(E, dots, 2);
+	rz = dots[0];
+	target = E->control.bfbt_accuracy * E->control.bfbt_accuracy * dots[1];
+
+	count = 0;
+	while(dots[1] > target && count < E->control.bfbt_iterations)
+	{
+		if(count == 0)
+			for(i = 1; i <= npno; i++)
+				s[i] = z[i];
+		else
+		{
+			beta = rz / rz0;
+			for(i = 1; i <= npno; i++)
+				s[i] = z[i] + beta * s[i];
+		}
+
+		assemble_grad_p(E, s, t, lev);
+		for(i = 0; i < neq; i++)
+			t[i] *= E->BI[lev][i];
+		assemble_div_u(E, t, Ap, lev);
+
+		alpha = rz / global_pdot(E, s, Ap, lev);
+		for(i = 1; i <= npno; i++)
+		{
+			y[i] += alpha * s[i];
+			q[i] -= alpha * Ap[i];
+			z[i] = E->BPI[lev][i] * q[i];
+		}
+
+		rz0 = rz;
+		dots[0] = local_pdot(E, q, z, lev);
+		dots[1] = local_pdot(E, q, q, lev);
+		global_sums(E, dots, 2);
+		rz = dots[0];
+		count++;
+	}
+
+	return;
+}
+
+
+
 void generate_log_message(int count,double time0,double timea,double dvelocity,double dpressure, struct All_variables *E){
 
   const int old_version=0;
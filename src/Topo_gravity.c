@@ -359,6 +359,7 @@ void get_stress(float *SXX,float *SXY,float *SXZ,float *SYY,float *SZY,float *SZ
 	float Vzz[9], Vxx[9], Vyy[9], Vxy[9], Vxz[9], Vzy[9];
 	//float pre[9], el_volume, tww[9], Visc, a, b;
 	float pre[9];
+	float *fields[6];
 	double rtf[4][9];
 #ifdef CITCOM_ALLOW_ANISOTROPIC_VISC
 	double D[6][6],n[3],eps[6],str[6];
@@ -499,12 +500,13 @@ void get_stress(float *SXX,float *SXY,float *SXZ,float *SYY,float *SZY,float *SZ
 
 	}
 
-	exchange_node_f20(E, SXX, lev);
-	exchange_node_f20(E, SZZ, lev);
-	exchange_node_f20(E, SXZ, lev);
-	exchange_node_f20(E, SXY, lev);
-	exchange_node_f20(E, SYY, lev);
-	exchange_node_f20(E, SZY, lev);
+	fields[0] = SXX;
+	fields[1] = SZZ;
+	fields[2] = SXZ;
+	fields[3] = SXY;
+	fields[4] = SYY;
+	fields[5] = SZY;
+	exchange_node_f20_fields(E, fields, 6, lev);
 
 	for(i = 1; i <= nno; i++)
 	{
@@ -305,6 +305,8 @@ void viscosity_parameters(struct All_variables *E)
 
 	/* iteration damping for alpha < 1 */
 	input_float("sdepv_iter_damp", &(E->viscosity.sdepv_iter_damp), "1.0",m);
+	/* Anderson acceleration of the iteration over that many iterates */
+	input_int("sdepv_anderson", &(E->viscosity.sdepv_anderson), "0,0,10",m);
 
 	input_boolean("TDEPV_AVE", &(E->viscosity.TDEPV_AVE), "off",m);
 	input_boolean("VFREEZE", &(E->viscosity.FREEZE), "off",m);
@@ -103,6 +103,16 @@
 
 #define MAX_NEIGHBORS 27
 
+/* multigrid smoothers (control.mg_smoother) */
+#define SMOOTH_GS 0
+#define SMOOTH_COLOUR_GS 1
+#define SMOOTH_CHEBYSHEV 2
+
+/* Schur complement preconditioners (control.schur_precond) */
+#define SCHUR_BPI 0
+#define SCHUR_VISC_MASS 1
+#define SCHUR_BFBT 2
+
 #define GGRD_MAX_NR_SLICE 5
 
 //#define CU_MPI_MSG_LIM 100	/* this increase wasn't necessary */
@@ -812,6 +822,18 @@ struct CONTROL
 	double augmented;
 	int faults;
 	int NASSEMBLE;
+	int node_gather;			/* use full-row node matrix, thread safe */
+	int overlap_exchange;			/* K*u boundary rows first, interior during the exchange */
+	int omp_threads;			/* 0: use OMP_NUM_THREADS */
+	int matrix_free;			/* finest level K applied element by element */
+	float stiffness_update_tol;		/* relative viscosity change that gets an element reassembled */
+	int stiffness_full_every;		/* full reassembly every so many stiffness updates */
+	int elt_k_cache;			/* element k from cached geometric tensors (cart3d) */
+	int elt_k_cache_max;			/* most element shapes cached per level */
+	int block_storage;			/* 3x3 node blocks for K*u and gauss_seidel */
+	int stencil_storage;			/* 3x3 node blocks at fixed stencil slots, no map */
+	int galerkin_coarse;			/* coarse K as P^T K P rather than rediscretised */
+	int mg_visc_transfer;			/* viscosity weighted interp_vector and project_vector */
 	int comparison;
 	int crust;
 	float plate_vel;
@@ -848,6 +870,26 @@ struct CONTROL
 	float max_res_red_each_p_mg;
 	float sub_stepping_factor;
 	int mg_cycle;
+	int mg_smoother;
+	int zline_levels;			/* finest levels smoothed by z-line Gauss-Seidel */
+	int mg_fcg;
+	int mg_fcg_iterations;
+	int stokes_fgmres;
+	int stokes_restart;
+	int stokes_extrapolate;
+	int uzawa_ew;
+	float ew_gamma;
+	float ew_max;
+	int schur_precond;
+	char SCHUR_TYPE[20];
+	double bfbt_accuracy;
+	int bfbt_iterations;
+	char SMOOTHER_TYPE[20];
+	double cheb_lmax[MAX_LEVELS];	/* largest eigenvalue of BI*K */
+	float cheb_eig_ratio;
+	int cheb_power_its;
+	int coarse_direct;
+	int coarse_direct_max;
 	int true_vcycle;
 	int down_heavy;
 	int up_heavy;
@@ -972,8 +1014,22 @@ struct All_variables
 	higher_precision *Eqn_k2[MAX_LEVELS];
 	higher_precision *Eqn_k3[MAX_LEVELS];
 	int *Node_map[MAX_LEVELS];
+	signed char *Elt_slot[MAX_LEVELS];	/* Node_map row offset of each element node pair, -1 if not stored */
+	double *Elt_T[MAX_LEVELS];	/* viscosity-free element k tensors per element shape (cart3d) */
+	int *Elt_shape[MAX_LEVELS];	/* shape of each element in Elt_T, -1 if not cached */
 	int *Node_eqn[MAX_LEVELS];
 	int *Node_k_id[MAX_LEVELS];
+	int *Row_map[MAX_LEVELS];	/* full-row (gather only) copy of Node_map/Eqn_k */
+	higher_precision *Row_k1[MAX_LEVELS];
+	higher_precision *Row_k2[MAX_LEVELS];
+	higher_precision *Row_k3[MAX_LEVELS];
+	int *Blk_map[MAX_LEVELS];	/* 3x3 block copy of Node_map/Eqn_k */
+	higher_precision *Blk_k[MAX_LEVELS];
+	higher_precision *Stn_k[MAX_LEVELS];	/* 14 block stencil per node, see construct_node_stencils */
+	double *Zln_k[MAX_LEVELS];	/* z-line block tridiagonal factors, see construct_zline_blocks */
+	double *Coarse_K;			/* banded Cholesky factor of the levmin operator */
+	int *Coarse_id;
+	int Coarse_bw;				/* its half bandwidth */
   
   int debug;
 	float *RVV[MAX_NEIGHBORS], *PVV[MAX_NEIGHBORS];
@@ -1005,6 +1061,10 @@ struct All_variables
 	double *XP[4], XG1[4], XG2[4];
 	double *BI[MAX_LEVELS];		/* inv of  diagonal elements of K matrix */
 	double *BPI[MAX_LEVELS];
+	double *BPM[MAX_LEVELS];	/* inverse of the viscosity-weighted pressure mass matrix */
+	double *BD[MAX_LEVELS];		/* unexchanged diagonal of K, for incremental updates */
+	float *EVI_K[MAX_LEVELS];	/* element viscosity K was last assembled with */
+	float *MGW[MAX_LEVELS];		/* interp_vector weights of the lower neighbour per node and axis */
 	float *V[4];				/* velocity X[dirn][node] can save memory */
 	float *V1[4];				/* velocity X[dirn][node] can save memory */
 	float *Vest[4];				/* velocity X[dirn][node] can save memory */
@@ -1012,6 +1072,9 @@ struct All_variables
 	float *heating_adi, *heating_visc, *heating_latent;
 
 	double *P, *F, *H, *S, *U;
+	double *Uhist[3], *Phist[3];	/* past solutions for stokes_extrapolate */
+	double thist[3];
+	int nhist;
 	float *stress;
 	float *Psi;
 	float *NP;
@@ -59,9 +59,18 @@ void construct_id(struct All_variables *);
 void construct_lm(struct All_variables *);
 void construct_node_maps(struct All_variables *);
 void construct_node_ks(struct All_variables *);
+void add_elt_k_to_node_ks(struct All_variables *, int, double [24 * 24], int, double);
+int update_node_ks(struct All_variables *);
+void construct_node_rows(struct All_variables *);
+void construct_node_blocks(struct All_variables *);
+void node_stencil_offsets(struct All_variables *, int, int [14]);
+void construct_node_stencils(struct All_variables *);
+void construct_zline_blocks(struct All_variables *);
+void construct_galerkin_coarse(struct All_variables *);
 void construct_masks(struct All_variables *);
 void construct_sub_element(struct All_variables *);
 void construct_elt_ks(struct All_variables *);
+void construct_elt_k_tensors(struct All_variables *);
 void construct_elt_gs(struct All_variables *);
 void construct_mat_group(struct All_variables *);
 void construct_stiffness_B_matrix(struct All_variables *);
@@ -83,6 +92,9 @@ void PG_process(struct All_variables *, int);
 void composition_apply_slab_influx_side_bc(struct All_variables *);
 /* Drive_solvers.c */
 void general_stokes_solver(struct All_variables *);
+void store_stokes_solution(struct All_variables *);
+void extrapolate_stokes_solution(struct All_variables *);
+void anderson_mix(struct All_variables *, double *, double, int);
 int need_to_iterate(struct All_variables *);
 /* Element_calculations.c */
 void assemble_forces(struct All_variables *, int);
@@ -92,7 +104,10 @@ void get_ba_p(struct Shape_function *, struct Shape_function_dx *, struct CC *,
 void assemble_del2_u(struct All_variables *, double *, double *, int, int);
 void e_assemble_del2_u(struct All_variables *, double *, double *, int, int);
 void n_assemble_del2_u(struct All_variables *, double *, double *, int, int);
+void mf_assemble_del2_u(struct All_variables *, double *, double *, int, int);
+void overlap_assemble_del2_u(struct All_variables *, double *, double *, int, int);
 void build_diagonal_of_K(struct All_variables *, int, double [24 * 24], int);
+double visc_mass_entry(struct All_variables *, int, int);
 void build_diagonal_of_Ahat(struct All_variables *);
 void assemble_div_u(struct All_variables *, double *, double *, int);
 void assemble_grad_p(struct All_variables *, double *, double *, int);
@@ -127,11 +142,19 @@ void vprod(double *, double *, double *, int, int);
 float fnmax(struct All_variables *, float *, int, int);
 int solve_del2_u(struct All_variables *, double *, double *, double, int);
 double multi_grid(struct All_variables *, double *, double *, double *, double, int);
+double mg_fcg(struct All_variables *, double *, double *, double, int *, int);
 double conj_grad(struct All_variables *, double *, double *, double *, double, int *, int);
 void jacobi(struct All_variables *, double *, double *, double *, double, int *, int, int);
 void element_gauss_seidel(struct All_variables *, double *, double *, double *, double, int *, int, int);
 void gauss_seidel1(struct All_variables *, double *, double *, double *, double, int *, int, int);
 void gauss_seidel(struct All_variables *, double *, double *, double *, double, int *, int, int);
+void colour_gauss_seidel(struct All_variables *, double *, double *, double *, double, int *, int, int);
+void zline_gauss_seidel(struct All_variables *, double *, double *, double *, double, int *, int, int);
+void chebyshev_smoother(struct All_variables *, double *, double *, double *, double, int *, int, int);
+void estimate_chebyshev_bounds(struct All_variables *);
+void mg_smooth(struct All_variables *, double *, double *, double *, double, int *, int, int);
+void factor_coarse_operator(struct All_variables *);
+void coarse_direct_solve(struct All_variables *, double *, double *, double *);
 void print_elt_k(struct All_variables *, double [24 * 24]);
 double cofactor(double [4][4], int, int, int);
 double determinant(double [4][4], int);
@@ -157,11 +180,16 @@ void ggrd_read_mat_from_file(struct All_variables *);
 void ggrd_solve_eigen3x3(double [3][3], double [3], double [3][3], struct All_variables *);
 float find_age_in_MY(struct All_variables *);
 /* Global_operations.c */
+void setup_layer_comms(struct All_variables *);
 void remove_horiz_ave(struct All_variables *, float *, float *, int);
 void return_horiz_sum(struct All_variables *, float *, float *, int);
 void return_horiz_ave(struct All_variables *, float *, float *);
+void return_horiz_ave_fields(struct All_variables *, float **, float **, int);
 float return_bulk_value(struct All_variables *, float *, float, int);
 double global_div_norm2(struct All_variables *, double *);
+double local_vdot(struct All_variables *, double *, double *, int);
+double local_pdot(struct All_variables *, double *, double *, int);
+void global_sums(struct All_variables *, double *, int);
 double global_vdot(struct All_variables *, double *, double *, int);
 double global_pdot(struct All_variables *, double *, double *, int);
 float global_tdot(struct All_variables *, float *, float *, int);
@@ -277,7 +305,12 @@ void add_processor_neighbor(int, int, int, struct All_variables *);
 void exchange_number_rec_markers(struct All_variables *);
 void exchange_markers(struct All_variables *);
 void exchange_id_d20(struct All_variables *, double *, int);
+void exchange_id_d20_begin(struct All_variables *, double *, int);
+int exchange_id_d20_progress(struct All_variables *);
+void exchange_id_d20_end(struct All_variables *);
 void exchange_node_f20(struct All_variables *, float *, int);
+void exchange_id_d20_fields(struct All_variables *, double **, int, int);
+void exchange_node_f20_fields(struct All_variables *, float **, int, int);
 void exchange_node_int(struct All_variables *, int *, int);
 double CPU_time0(void);
 void parallel_process_sync(void);
@@ -334,6 +367,8 @@ void set_mg_defaults(struct All_variables *);
 void mg_allocate_vars(struct All_variables *);
 void project_vector(struct All_variables *, int, double *, double *, int);
 void interp_vector(struct All_variables *, int, double *, double *);
+void construct_mg_transfer_weights(struct All_variables *);
+void project_vector_weighted(struct All_variables *, int, double *, double *);
 void project_scalar_e(struct All_variables *, int, float *, float *);
 void project_scalar(struct All_variables *, int, float *, float *);
 void project_viscosity(struct All_variables *);
@@ -354,6 +389,9 @@ void solve_constrained_flow_iterative(struct All_variables *);
 float solve_Ahat_p_fhat_new(struct All_variables *, double *, double *, double *, double, int *);
 void initial_vel_residual(struct All_variables *, double *, double *, double *, double *, double);
 float solve_Ahat_p_fhat(struct All_variables *, double *, double *, double *, double, int *);
+float solve_Ahat_p_fhat_fgmres(struct All_variables *, double *, double *, double *, double, int *);
+void schur_precondition(struct All_variables *, double *, double *, int);
+void bfbt_poisson(struct All_variables *, double *, double *, int);
 void generate_log_message(int, double, double, double, double, struct All_variables *);
 void v_from_vector(struct All_variables *, float **, double *);
 void vector_from_v(struct All_variables *, double *, float **);
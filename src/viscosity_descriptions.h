@@ -99,6 +99,7 @@ struct VISC_OPT
 	float sdepv_misfit;
   int sdepv_rheology;
 	float sdepv_iter_damp;
+	int sdepv_anderson;		/* depth of Anderson mixing, 0 for plain Picard */
 	int sdepv_normalize;
     int crust_option;
 	float sdepv_expt[CITCOM_CU_VISC_MAXLAYER];